@@ -0,0 +1,2072 @@
+//=============================================================================
+//
+// Headless benchmark of the IK solvers. Builds a chain of configurable depth,
+// replays a target trajectory and reports solver throughput, iterations to
+// converge, final error and heap allocations per step. Never opens a window.
+//
+//=============================================================================
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "armadillo"
+#include "glmath.h"
+#include "kinematics.h"
+#include "kinematics_batch.h"
+#include "math_util.h"
+#include "joint/joint.h"
+#include "joint/static_chain.h"
+#include "bezier.h"
+#include "trajectory.h"
+#include "time_parameterization.h"
+#include "mesh/mesh_builder.h"
+#include "simd.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+//=============================================================================
+// allocation counting, only enabled around the solver steps
+
+
+static bool count_allocations = false;
+static unsigned long long n_allocations = 0;
+
+#if defined(__GLIBC__)
+
+// Armadillo allocates with posix_memalign, not operator new, so with glibc
+// the C allocation functions are interposed; operator new ends up in malloc
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+
+void* malloc(size_t _size)
+{
+    if (count_allocations) n_allocations++;
+    return __libc_malloc(_size);
+}
+
+void* calloc(size_t _n, size_t _size)
+{
+    if (count_allocations) n_allocations++;
+    return __libc_calloc(_n, _size);
+}
+
+void* realloc(void* _p, size_t _size)
+{
+    if (count_allocations) n_allocations++;
+    return __libc_realloc(_p, _size);
+}
+
+int posix_memalign(void** _p, size_t _alignment, size_t _size)
+{
+    if (count_allocations) n_allocations++;
+    *_p = __libc_memalign(_alignment, _size);
+    return *_p ? 0 : ENOMEM;
+}
+}
+
+#else
+
+// elsewhere only allocations through operator new are seen
+void* operator new(size_t _size)
+{
+    if (count_allocations) n_allocations++;
+    void* p = std::malloc(_size ? _size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t _size)
+{
+    return operator new(_size);
+}
+
+void operator delete(void* _p) noexcept
+{
+    std::free(_p);
+}
+
+void operator delete[](void* _p) noexcept
+{
+    std::free(_p);
+}
+
+#endif
+
+
+//=============================================================================
+
+
+struct Options
+{
+    std::string scenario = "bezier";
+    unsigned int depth = 3;
+    /// rotational joints of the chain: "mixed" cycles through ball, hinge and axial
+    std::string joints = "mixed";
+    solver_t solver = DAMPED_LEAST_SQUARES;
+    jacobian_mode_t jacobian_mode = ANALYTIC;
+    /// step: one Kinematics::step() per iteration, solve: one Kinematics::solve() per target
+    bool use_solve = false;
+    /// symmetric limit of every DOF in degrees, 0 for unlimited
+    float limits = 0.0f;
+    limit_handling_t limit_handling = CLAMP_DOFS;
+    /// secondary objective in the null space of the task, "none" for none
+    std::string objective = "none";
+    float objective_weight = 0.1f;
+    unsigned int seed = 1;
+    unsigned int n_targets = 500;
+    unsigned int max_iterations = 200;
+    float tolerance = 1e-3f;
+    bool json = false;
+    /// pass/fail thresholds of the trajectory and tree scenarios, only checked when given:
+    /// targets that have to converge, allocations per step and mean manipulability
+    unsigned int min_converged = 0;
+    double max_allocations = -1.0;
+    double min_manipulability = 0.0;
+};
+
+
+struct Result
+{
+    unsigned long long n_steps = 0;
+    double seconds = 0.0;
+    /// heap allocations in the solver once a target took a step: that target sizes the
+    /// scratch space of the chain
+    unsigned long long n_allocations = 0;
+    unsigned int n_targets = 0;
+    unsigned int n_converged = 0;
+    double mean_iterations = 0.0;
+    unsigned int max_iterations = 0;
+    double mean_error = 0.0;
+    double max_error = 0.0;
+    double jacobian_deviation = 0.0;
+    /// forward passes of the line search and targets given up on, solve driver only
+    unsigned long long n_line_search = 0;
+    unsigned int n_stalled = 0;
+    /// manipulability of the solved states, trajectory scenarios only
+    double mean_manipulability = 0.0;
+    double min_manipulability = 0.0;
+    /// chains whose batch result differs from a serial solve on a fresh copy of the chain,
+    /// batch scenario only
+    unsigned int n_serial_mismatches = 0;
+    /// degrees by which a solved DOF lies outside its limits, with --limits only
+    double limit_violation = 0.0;
+    /// largest distance between the cached end effector positions and those of a chain
+    /// that computes all frames anew, tree scenario only
+    double cache_deviation = 0.0;
+};
+
+
+/// degrees by which the DOFs of _chain lie outside +-_limits, 0 without limits
+static double limit_violation(Kinematics& _chain, float _limits)
+{
+    double violation = 0.0;
+    if (_limits > 0.0f) {
+        for (float value : _chain.dof_values()) {
+            violation = std::max(violation, (double)std::abs(value) - _limits);
+        }
+    }
+    return violation;
+}
+
+
+static const float reach = 4.5f;
+
+
+static const char* solver_name(solver_t _solver)
+{
+    switch (_solver) {
+        case PSEUDO_INVERSE:     return "pinv";
+        case JACOBIAN_TRANSPOSE: return "transpose";
+        case CYCLIC_COORDINATE_DESCENT: return "ccd";
+        case FABRIK:             return "fabrik";
+        default:                 return "dls";
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// chain of _depth joints cycling through Ball, Hinge and Axial, or only balls,
+/// hinges or axial joints, every joint followed by a bone, with a total length of reach
+static void build_chain(Kinematics& _chain, unsigned int _depth, const std::string& _joints)
+{
+    const float bone_length = reach / _depth;
+
+    for (unsigned int i = 0; i < _depth; i++) {
+        const unsigned int type = _joints == "ball" ? 0 : _joints == "hinge" ? 1 : _joints == "axial" ? 2 : i % 3;
+        switch (type) {
+            case 0: _chain.add_joint(Joint::ball()); break;
+            case 1: _chain.add_joint(Joint::hinge()); break;
+            case 2: _chain.add_joint(Joint::axial()); break;
+        }
+        _chain.add_joint(Joint::bone(bone_length));
+    }
+}
+
+
+/// torso with two arms, a ball and a bone each, the arms end in a hinge and a
+/// bone; one end effector per hand
+static void build_tree(Kinematics& _chain)
+{
+    _chain.add_joint(Joint::ball());
+    const size_t torso = _chain.add_joint(Joint::bone(1.5f));
+
+    for (int arm = 0; arm < 2; arm++) {
+        _chain.add_joint(Joint::ball(), (int)torso);
+        _chain.add_joint(Joint::bone(1.2f));
+        _chain.add_joint(Joint::hinge());
+        _chain.add_end_effector(_chain.add_joint(Joint::bone(1.0f)));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// the per point evaluation Inv_kin_viewer::cubicBezier used before Trajectory, as reference:
+/// pow() per axis, uniform in the parameter and stopping short of the end point
+static std::vector<vec4> reference_cubic_bezier(vec4 _p0, vec4 _p1, vec4 _p2, vec4 _p3, int _n)
+{
+    std::vector<vec4> curve(_n, vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    curve[0] = _p0;
+    curve[_n-1] = _p3;
+
+    for (int i = 1; i < _n-1; i++) {
+        float t = (1.0f / (_n+1)) * i;
+        for (int k = 0; k < 3; k++) {
+            curve[i][k] = pow(1-t, 3) * _p0[k] +
+                          pow(1-t, 2) * 3 * t * _p1[k] +
+                          (1-t) * 3 * t * t * _p2[k] +
+                          t * t * t * _p3[k];
+        }
+    }
+    return curve;
+}
+
+
+/// same curve as Inv_kin_viewer::cubicBezier
+static std::vector<vec4> cubic_bezier(vec4 _p0, vec4 _p1, vec4 _p2, vec4 _p3, int _n)
+{
+    Trajectory curve;
+    curve.set_cubic(vec3(_p0[0], _p0[1], _p0[2]), vec3(_p1[0], _p1[1], _p1[2]),
+                    vec3(_p2[0], _p2[1], _p2[2]), vec3(_p3[0], _p3[1], _p3[2]));
+    return curve.sample(_n);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// target trajectory of the scenario, starting at the end effector _start
+static std::vector<vec4> make_targets(const Options& _options, const vec4& _start)
+{
+    const float s = reach / 4.5f;
+    const vec4 end(2.0f * s, 1.5f * s, 0.0f, 1.0f);
+    std::vector<vec4> targets;
+
+    if (_options.scenario == "bezier") {
+        targets = cubic_bezier(_start,
+                               vec4(-1.0f * s, 3.0f * s, 0.0f, 1.0f),
+                               vec4(4.0f * s, 2.5f * s, 0.0f, 1.0f),
+                               end, _options.n_targets);
+    }
+    else if (_options.scenario == "line") {
+        for (unsigned int i = 0; i < _options.n_targets; i++) {
+            float t = (float)i / (_options.n_targets - 1);
+            targets.push_back((1.0f - t) * _start + t * end);
+        }
+    }
+    else {
+        // uniformly distributed in the ball of 0.9 * reach around the root
+        std::mt19937 rng(_options.seed);
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        while (targets.size() < _options.n_targets) {
+            vec3 p(uniform(rng), uniform(rng), uniform(rng));
+            if (norm(p) > 1.0f) continue;
+            p *= 0.9f * reach;
+            targets.push_back(vec4(p[0], p[1], p[2], 1.0f));
+        }
+    }
+    return targets;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// largest difference between the analytic and finite-difference Jacobian
+static double jacobian_deviation(Kinematics& _chain)
+{
+    arma::mat analytic, fd;
+    _chain.set_jacobian_mode(ANALYTIC);
+    _chain.jacobian(_chain.n_end_effectors(), true, analytic);
+    _chain.set_jacobian_mode(FINITE_DIFFERENCES);
+    _chain.jacobian(_chain.n_end_effectors(), true, fd);
+    return arma::abs(analytic - fd).max();
+}
+
+
+/// largest difference between analytic and finite-difference entries that counts as agreement.
+/// The finite differences perturb a DOF by 1e-3 degrees in single precision, one ulp
+/// of a coordinate near reach is 5e-4 per degree, and up to 2e-3 is seen at random
+/// states. A wrong axis or pivot is off by the size of the entries, around 1e-2 to 8e-2
+static const double jacobian_tolerance = 5e-3;
+
+
+struct Jacobian_case
+{
+    std::string joints;
+    unsigned int depth;
+    unsigned int rows;
+    double deviation;
+};
+
+
+/// analytic against finite-difference Jacobian at random states, 3 and 6 rows, of
+/// chains of every joint type and of the two armed tree
+static std::vector<Jacobian_case> run_jacobian(const Options& _options)
+{
+    std::vector<Jacobian_case> cases;
+    std::mt19937 rng(_options.seed);
+    std::uniform_real_distribution<float> angle(-90.0f, 90.0f);
+    arma::mat analytic, fd;
+
+    const char* joint_types[] = {"ball", "hinge", "axial", "mixed", "tree"};
+    for (const char* joints : joint_types) {
+        const bool tree = std::string(joints) == "tree";
+        for (unsigned int depth : {1u, 3u, 6u}) {
+            if (tree && depth != 1) continue;
+            Kinematics chain;
+            if (tree) {
+                build_tree(chain);
+            } else {
+                build_chain(chain, depth, joints);
+            }
+
+            for (unsigned int rows : {3u, 6u}) {
+                Jacobian_case c = {joints, tree ? 0 : depth, rows, 0.0};
+                std::vector<float> values(chain.n_dofs());
+                for (unsigned int i = 0; i < _options.n_targets; i++) {
+                    for (float& v : values) {
+                        v = angle(rng);
+                    }
+                    chain.set_dof_values(Span<const float>(values.data(), values.size()));
+                    chain.set_jacobian_mode(ANALYTIC);
+                    chain.jacobian(chain.n_end_effectors(), rows == 6, analytic);
+                    chain.set_jacobian_mode(FINITE_DIFFERENCES);
+                    chain.jacobian(chain.n_end_effectors(), rows == 6, fd);
+                    c.deviation = std::max(c.deviation, (double)arma::abs(analytic - fd).max());
+                }
+                cases.push_back(c);
+            }
+        }
+    }
+    return cases;
+}
+
+
+/// prints the cases, returns false if any of them deviates by more than jacobian_tolerance
+static bool print_jacobian_result(const Options& _options, const std::vector<Jacobian_case>& _cases)
+{
+    bool passed = true;
+    for (const Jacobian_case& c : _cases) {
+        passed = passed && c.deviation <= jacobian_tolerance;
+    }
+
+    if (_options.json) {
+        printf("{\"scenario\": \"jacobian\", \"seed\": %u, \"states\": %u, \"tolerance\": %.1e, \"passed\": %s, \"cases\": [",
+               _options.seed, _options.n_targets, jacobian_tolerance, passed ? "true" : "false");
+        for (size_t i = 0; i < _cases.size(); i++) {
+            const Jacobian_case& c = _cases[i];
+            printf("%s{\"joints\": \"%s\", \"depth\": %u, \"rows\": %u, \"deviation\": %.3e}",
+                   i ? ", " : "", c.joints.c_str(), c.depth, c.rows, c.deviation);
+        }
+        printf("]}\n");
+        return passed;
+    }
+
+    printf("scenario            jacobian, analytic vs finite differences at %u states (seed %u)\n",
+           _options.n_targets, _options.seed);
+    for (const Jacobian_case& c : _cases) {
+        if (c.joints == "tree") {
+            printf("tree, %u rows        deviation %.3e%s\n", c.rows, c.deviation,
+                   c.deviation <= jacobian_tolerance ? "" : "  FAILED");
+        } else {
+            printf("%-6s depth %u, %u rows deviation %.3e%s\n", c.joints.c_str(), c.depth, c.rows, c.deviation,
+                   c.deviation <= jacobian_tolerance ? "" : "  FAILED");
+        }
+    }
+    printf("check               %s, tolerance %.1e\n", passed ? "passed" : "FAILED", jacobian_tolerance);
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// follows the targets one after the other, iterating on each until converged
+static Result run_trajectory(Kinematics& _chain, const std::vector<vec4>& _targets, const Options& _options)
+{
+    Result result;
+    result.n_targets = _targets.size();
+
+    typedef std::chrono::steady_clock clock;
+    clock::duration elapsed = clock::duration::zero();
+
+    Solve_options solve_options;
+    solve_options.tolerance = _options.tolerance;
+    solve_options.max_iterations = _options.max_iterations;
+    bool warmed_up = false;
+
+    for (const vec4& target : _targets) {
+        const vec3 goal(target[0], target[1], target[2]);
+        float error = norm(_chain.end_effector().translation_ - goal);
+        unsigned int iterations = 0;
+
+        if (_options.use_solve) {
+            clock::time_point start = clock::now();
+            count_allocations = warmed_up;
+            Solve_outcome outcome = _chain.solve(target, solve_options);
+            count_allocations = false;
+            elapsed += clock::now() - start;
+
+            error = outcome.residual;
+            iterations = outcome.iterations;
+            result.n_line_search += outcome.forward_evaluations;
+            if (outcome.termination == STALLED) result.n_stalled++;
+        }
+
+        while (!_options.use_solve && error > _options.tolerance && iterations < _options.max_iterations) {
+            clock::time_point start = clock::now();
+            count_allocations = warmed_up;
+            _chain.step(target, 1.0f);
+            count_allocations = false;
+            elapsed += clock::now() - start;
+
+            error = norm(_chain.end_effector().translation_ - goal);
+            iterations++;
+        }
+
+        result.n_steps += iterations;
+        warmed_up = warmed_up || iterations > 0;
+        result.limit_violation = std::max(result.limit_violation, limit_violation(_chain, _options.limits));
+        if (error <= _options.tolerance) result.n_converged++;
+        result.mean_iterations += iterations;
+        result.max_iterations = std::max(result.max_iterations, iterations);
+        result.mean_error += error;
+        result.max_error = std::max(result.max_error, (double)error);
+
+        double manipulability = _chain.manipulability();
+        result.mean_manipulability += manipulability;
+        result.min_manipulability = &target == &_targets[0] ? manipulability
+                                                            : std::min(result.min_manipulability, manipulability);
+    }
+
+    result.mean_manipulability /= result.n_targets;
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    result.n_allocations = n_allocations;
+    result.mean_iterations /= result.n_targets;
+    result.mean_error /= result.n_targets;
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// largest distance of an end effector of _chain to its target
+static float tree_error(Kinematics& _chain, const std::vector<vec4>& _targets)
+{
+    float error = 0.0f;
+    for (size_t e = 0; e < _targets.size(); e++) {
+        const vec3 goal(_targets[e][0], _targets[e][1], _targets[e][2]);
+        error = std::max(error, norm(_chain.end_effector(e).translation_ - goal));
+    }
+    return error;
+}
+
+
+/// moves all end effectors of a tree at once, the targets are the end effectors
+/// of random states, so every target set can be reached
+/// largest distance between the end effectors of _chain, from the frames cached over the
+/// last steps, and those of a new tree in the same state, which computes every frame
+static double cache_deviation(Kinematics& _chain)
+{
+    Kinematics fresh;
+    build_tree(fresh);
+    const std::vector<float> state = _chain.copy_state();
+    fresh.set_state(Span<const float>(state.data(), state.size()));
+    double deviation = 0.0;
+    for (size_t e = 0; e < _chain.n_end_effectors(); e++) {
+        deviation = std::max(deviation, (double)norm(_chain.end_effector(e).translation_ - fresh.end_effector(e).translation_));
+    }
+    return deviation;
+}
+
+
+static Result run_tree(Kinematics& _chain, const Options& _options)
+{
+    Result result;
+    result.n_targets = _options.n_targets;
+
+    typedef std::chrono::steady_clock clock;
+    clock::duration elapsed = clock::duration::zero();
+
+    Solve_options solve_options;
+    solve_options.tolerance = _options.tolerance;
+    solve_options.max_iterations = _options.max_iterations;
+
+    const std::vector<float> start_state = _chain.copy_state();
+    std::mt19937 rng(_options.seed);
+    std::uniform_real_distribution<float> angle(-60.0f, 60.0f);
+    std::vector<std::vector<vec4>> target_sets(_options.n_targets);
+    std::vector<float> state(_chain.n_dofs());
+    for (std::vector<vec4>& targets : target_sets) {
+        for (float& s : state) {
+            s = angle(rng);
+        }
+        _chain.set_dof_values(Span<const float>(state.data(), state.size()));
+        for (size_t e = 0; e < _chain.n_end_effectors(); e++) {
+            targets.push_back(vec4(_chain.end_effector(e).translation_, 1.0f));
+        }
+    }
+    _chain.set_state(Span<const float>(start_state.data(), start_state.size()));
+
+    bool warmed_up = false;
+    for (const std::vector<vec4>& targets : target_sets) {
+        float error = tree_error(_chain, targets);
+        unsigned int iterations = 0;
+
+        if (_options.use_solve) {
+            clock::time_point start = clock::now();
+            count_allocations = warmed_up;
+            Solve_outcome outcome = _chain.solve(targets, solve_options);
+            count_allocations = false;
+            elapsed += clock::now() - start;
+
+            error = tree_error(_chain, targets);
+            iterations = outcome.iterations;
+            result.n_line_search += outcome.forward_evaluations;
+            if (outcome.termination == STALLED) result.n_stalled++;
+        }
+
+        while (!_options.use_solve && error > _options.tolerance && iterations < _options.max_iterations) {
+            clock::time_point start = clock::now();
+            count_allocations = warmed_up;
+            _chain.step(targets, 1.0f);
+            count_allocations = false;
+            elapsed += clock::now() - start;
+
+            error = tree_error(_chain, targets);
+            iterations++;
+        }
+
+        result.n_steps += iterations;
+        warmed_up = warmed_up || iterations > 0;
+        result.limit_violation = std::max(result.limit_violation, limit_violation(_chain, _options.limits));
+        result.cache_deviation = std::max(result.cache_deviation, cache_deviation(_chain));
+        if (error <= _options.tolerance) result.n_converged++;
+        result.mean_iterations += iterations;
+        result.max_iterations = std::max(result.max_iterations, iterations);
+        result.mean_error += error;
+        result.max_error = std::max(result.max_error, (double)error);
+
+        double manipulability = _chain.manipulability();
+        result.mean_manipulability += manipulability;
+        result.min_manipulability = &targets == &target_sets[0] ? manipulability
+                                                                : std::min(result.min_manipulability, manipulability);
+    }
+
+    result.mean_manipulability /= result.n_targets;
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    result.n_allocations = n_allocations;
+    result.mean_iterations /= result.n_targets;
+    result.mean_error /= result.n_targets;
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+struct Pose_result
+{
+    unsigned int n_targets = 0;
+    unsigned int n_converged = 0;
+    unsigned long long n_steps = 0;
+    double seconds = 0.0;
+    unsigned int max_iterations = 0;
+    /// distance and rotation angle in degrees of the end effector to the target pose,
+    /// measured on the end effector frame, largest over the converged targets and over all
+    double max_position_error = 0.0;
+    double max_rotation_error = 0.0;
+    double max_position_residual = 0.0;
+    double max_rotation_residual = 0.0;
+};
+
+
+/// distance and rotation angle in degrees from the first end effector of _chain to a pose
+static void pose_error(Kinematics& _chain, const vec4& _location, const mat4& _orientation,
+                       double& _position_error, double& _rotation_error)
+{
+    const Rigid_transform frame = _chain.end_effector();
+    _position_error = norm(frame.translation_ - vec3(_location[0], _location[1], _location[2]));
+    _rotation_error = rad2deg(norm(rotation_log(mat3(_orientation) * transpose(frame.rotation_))));
+}
+
+
+/// position and orientation targets, the end effector frames of random states, so every
+/// pose can be reached. Each target is solved from the previous solution
+static Pose_result run_pose(Kinematics& _chain, const Options& _options)
+{
+    Pose_result result;
+    result.n_targets = _options.n_targets;
+
+    std::mt19937 rng(_options.seed);
+    std::uniform_real_distribution<float> angle(-60.0f, 60.0f);
+    const std::vector<float> start_state = _chain.copy_state();
+    std::vector<vec4> locations(result.n_targets);
+    std::vector<mat4> orientations(result.n_targets);
+    std::vector<float> values(_chain.n_dofs());
+    for (unsigned int i = 0; i < result.n_targets; i++) {
+        for (float& v : values) {
+            v = angle(rng);
+        }
+        _chain.set_dof_values(Span<const float>(values.data(), values.size()));
+        const Rigid_transform frame = _chain.end_effector();
+        locations[i] = vec4(frame.translation_, 1.0f);
+        orientations[i] = mat4(frame.rotation_);
+    }
+    _chain.set_state(Span<const float>(start_state.data(), start_state.size()));
+
+    Solve_options solve_options;
+    solve_options.tolerance = _options.tolerance;
+    solve_options.max_iterations = _options.max_iterations;
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point start = clock::now();
+
+    for (unsigned int i = 0; i < result.n_targets; i++) {
+        double position_error, rotation_error;
+        unsigned int iterations = 0;
+        if (_options.use_solve) {
+            iterations = _chain.solve(locations[i], orientations[i], solve_options).iterations;
+            pose_error(_chain, locations[i], orientations[i], position_error, rotation_error);
+        }
+        else {
+            // the error step() minimizes, the position and the rotation in radians stacked
+            pose_error(_chain, locations[i], orientations[i], position_error, rotation_error);
+            while (hypot(position_error, deg2rad(rotation_error)) > _options.tolerance && iterations < _options.max_iterations) {
+                _chain.step(locations[i], orientations[i], 1.0f);
+                pose_error(_chain, locations[i], orientations[i], position_error, rotation_error);
+                iterations++;
+            }
+        }
+
+        result.n_steps += iterations;
+        result.max_iterations = std::max(result.max_iterations, iterations);
+        result.max_position_residual = std::max(result.max_position_residual, position_error);
+        result.max_rotation_residual = std::max(result.max_rotation_residual, rotation_error);
+        if (hypot(position_error, deg2rad(rotation_error)) <= _options.tolerance) {
+            result.n_converged++;
+            result.max_position_error = std::max(result.max_position_error, position_error);
+            result.max_rotation_error = std::max(result.max_rotation_error, rotation_error);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return result;
+}
+
+
+/// prints the result, returns false if fewer than 95% of the poses were reached, or a
+/// reached pose is further than the tolerance from its target in position or rotation
+static bool print_pose_result(const Options& _options, const Pose_result& _result)
+{
+    const double rotation_tolerance = rad2deg(_options.tolerance);
+    const bool passed = _result.n_converged >= 0.95 * _result.n_targets
+                        && _result.max_position_error <= _options.tolerance
+                        && _result.max_rotation_error <= rotation_tolerance;
+
+    if (_options.json) {
+        printf("{\"scenario\": \"pose\", \"solver\": \"%s\", \"driver\": \"%s\", \"seed\": %u, \"targets\": %u, "
+               "\"converged\": %u, \"steps\": %llu, \"seconds\": %.6f, \"max_iterations\": %u, "
+               "\"max_position_error\": %.3e, \"max_rotation_error_deg\": %.3e, "
+               "\"max_position_residual\": %.3e, \"max_rotation_residual_deg\": %.3e, \"passed\": %s}\n",
+               solver_name(_options.solver), _options.use_solve ? "solve" : "step", _options.seed,
+               _result.n_targets, _result.n_converged, _result.n_steps, _result.seconds, _result.max_iterations,
+               _result.max_position_error, _result.max_rotation_error,
+               _result.max_position_residual, _result.max_rotation_residual, passed ? "true" : "false");
+        return passed;
+    }
+
+    printf("scenario            pose, %u position and orientation targets (seed %u)\n", _result.n_targets, _options.seed);
+    printf("solver              %s, %s driver\n", solver_name(_options.solver), _options.use_solve ? "solve" : "step");
+    printf("converged           %u of %u targets, %llu steps in %.3f s, max %u iterations\n",
+           _result.n_converged, _result.n_targets, _result.n_steps, _result.seconds, _result.max_iterations);
+    printf("reached poses       position %.3e, rotation %.3e deg at most\n",
+           _result.max_position_error, _result.max_rotation_error);
+    printf("all poses           position %.3e, rotation %.3e deg at most\n",
+           _result.max_position_residual, _result.max_rotation_residual);
+    printf("check               %s, 95%% of the targets within %.1e and %.1e deg\n",
+           passed ? "passed" : "FAILED", _options.tolerance, rotation_tolerance);
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// solves all targets as independent chains with Kinematics_batch
+static Result run_batch(Kinematics& _chain, const std::vector<vec4>& _targets, const Options& _options)
+{
+    Result result;
+    result.n_targets = _targets.size();
+
+    Kinematics_batch batch(_chain);
+    batch.set_tolerance(_options.tolerance);
+    std::vector<float> states;
+#ifdef _OPENMP
+    // more threads than the batch was built for, solve() has to add their workers
+    const int n_threads = omp_get_max_threads();
+    omp_set_num_threads(n_threads + 1);
+#endif
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    count_allocations = true;
+    batch.solve(_targets, states, _options.max_iterations);
+    count_allocations = false;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.n_allocations = n_allocations;
+#ifdef _OPENMP
+    omp_set_num_threads(n_threads);
+#endif
+
+    // every chain solved alone from the prototype, the batch has to give the same states
+    // whichever worker solved a chain and whatever it solved before
+    const size_t state_size = _chain.state_size();
+    const std::vector<float> initial_state = _chain.copy_state();
+    for (size_t c = 0; c < _targets.size(); c++) {
+        Kinematics serial = _chain;
+        serial.set_state(Span<const float>(initial_state.data(), state_size));
+        const vec3 goal(_targets[c][0], _targets[c][1], _targets[c][2]);
+        unsigned int step = 0;
+        float error = norm(serial.end_effector().translation_ - goal);
+        while (error > _options.tolerance && step < _options.max_iterations) {
+            serial.step(_targets[c], 1.0f);
+            error = norm(serial.end_effector().translation_ - goal);
+            step++;
+        }
+        if (step != batch.steps()[c] || !std::equal(serial.state().begin(), serial.state().end(), &states[c * state_size])) {
+            result.n_serial_mismatches++;
+        }
+    }
+
+    for (size_t c = 0; c < _targets.size(); c++) {
+        unsigned int iterations = batch.steps()[c];
+        float error = batch.errors()[c];
+        result.n_steps += iterations;
+        if (error <= _options.tolerance) result.n_converged++;
+        result.mean_iterations += iterations;
+        result.max_iterations = std::max(result.max_iterations, iterations);
+        result.mean_error += error;
+        result.max_error = std::max(result.max_error, (double)error);
+    }
+    result.mean_iterations /= result.n_targets;
+    result.mean_error /= result.n_targets;
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// the chain of the viewer, once with the layout fixed at compile time
+typedef Static_chain<Ball_joint, Bone_joint, Hinge_joint, Bone_joint, Axial_joint> Viewer_chain;
+
+
+struct Static_result
+{
+    unsigned int n_states = 0;
+    unsigned int n_rounds = 0;
+    double dynamic_forward_ns = 0.0;
+    double static_forward_ns = 0.0;
+    double dynamic_jacobian_ns = 0.0;
+    double static_jacobian_ns = 0.0;
+    unsigned long long static_allocations = 0;
+    double forward_deviation = 0.0;
+    double jacobian_deviation = 0.0;
+};
+
+
+/// forward kinematics and analytic Jacobian of the viewer chain, through
+/// Kinematics and through Static_chain, evaluated at random states
+static Static_result run_static(const Options& _options)
+{
+    Static_result result;
+    result.n_states = _options.n_targets;
+    result.n_rounds = 200;
+
+    Kinematics dynamic_chain;
+    dynamic_chain.add_joint(Joint::ball());
+    dynamic_chain.add_joint(Joint::bone(2.0f));
+    dynamic_chain.add_joint(Joint::hinge());
+    dynamic_chain.add_joint(Joint::bone(1.5f));
+    dynamic_chain.add_joint(Joint::axial());
+    dynamic_chain.set_jacobian_mode(ANALYTIC);
+
+    const Viewer_chain static_chain(Ball_joint(), Bone_joint(2.0f), Hinge_joint(), Bone_joint(1.5f), Axial_joint());
+    const size_t n_dofs = Viewer_chain::n_dofs;
+    const size_t state_size = Viewer_chain::state_size;
+    assert(n_dofs == dynamic_chain.n_dofs() && state_size == dynamic_chain.state_size());
+
+    // random DOF values, converted to states by the dynamic chain
+    std::mt19937 rng(_options.seed);
+    std::uniform_real_distribution<float> angle(-90.0f, 90.0f);
+    std::vector<float> states(result.n_states * state_size);
+    std::vector<float> values(n_dofs);
+    for (unsigned int i = 0; i < result.n_states; i++) {
+        for (float& v : values) {
+            v = angle(rng);
+        }
+        dynamic_chain.set_dof_values(Span<const float>(values.data(), n_dofs));
+        Span<const float> state = dynamic_chain.state();
+        std::copy(state.begin(), state.end(), &states[i * state_size]);
+    }
+
+    typedef std::chrono::steady_clock clock;
+    std::vector<float> state(state_size);
+    arma::mat J(6, n_dofs);
+    float J_static[6 * n_dofs];
+    double evaluations = (double)result.n_states * result.n_rounds;
+    float sink = 0.0f;
+
+    // one untimed pass over the states, so the first timed loop does not pay for the warm up
+    for (unsigned int i = 0; i < result.n_states; i++) {
+        std::copy(&states[i * state_size], &states[i * state_size] + state_size, state.begin());
+        sink += dynamic_chain.forward(state).translation_[0];
+        sink += static_chain.forward(&states[i * state_size]).translation_[0];
+    }
+
+    // forward kinematics
+    clock::time_point start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        for (unsigned int i = 0; i < result.n_states; i++) {
+            std::copy(&states[i * state_size], &states[i * state_size] + state_size, state.begin());
+            sink += dynamic_chain.forward(state).translation_[0];
+        }
+    }
+    result.dynamic_forward_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / evaluations;
+
+    n_allocations = 0;
+    count_allocations = true;
+    start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        for (unsigned int i = 0; i < result.n_states; i++) {
+            sink += static_chain.forward(&states[i * state_size]).translation_[0];
+        }
+    }
+    result.static_forward_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / evaluations;
+    count_allocations = false;
+
+    // Jacobian
+    start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        for (unsigned int i = 0; i < result.n_states; i++) {
+            dynamic_chain.set_state(Span<const float>(&states[i * state_size], state_size));
+            dynamic_chain.jacobian(6, J);
+            sink += (float)J(0, 0);
+        }
+    }
+    result.dynamic_jacobian_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / evaluations;
+
+    count_allocations = true;
+    start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        for (unsigned int i = 0; i < result.n_states; i++) {
+            static_chain.jacobian(&states[i * state_size], 6, J_static);
+            sink += J_static[0];
+        }
+    }
+    result.static_jacobian_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / evaluations;
+    count_allocations = false;
+    result.static_allocations = n_allocations;
+
+    // both paths have to agree
+    for (unsigned int i = 0; i < result.n_states; i++) {
+        std::copy(&states[i * state_size], &states[i * state_size] + state_size, state.begin());
+        vec3 dynamic_end = dynamic_chain.forward(state).translation_;
+        vec3 static_end = static_chain.forward(&states[i * state_size]).translation_;
+        result.forward_deviation = std::max(result.forward_deviation, (double)norm(dynamic_end - static_end));
+
+        dynamic_chain.set_state(Span<const float>(&states[i * state_size], state_size));
+        dynamic_chain.jacobian(6, J);
+        static_chain.jacobian(&states[i * state_size], 6, J_static);
+        for (size_t k = 0; k < 6 * n_dofs; k++) {
+            result.jacobian_deviation = std::max(result.jacobian_deviation, std::abs(J(k) - J_static[k]));
+        }
+    }
+
+    if (sink == 12345.0f) printf(" ");
+    return result;
+}
+
+
+/// prints the result, returns false unless both chains agree exactly and the static
+/// chain never allocates: they run the same joint code in the same order
+static bool print_static_result(const Options& _options, const Static_result& _result)
+{
+    const bool passed = _result.forward_deviation == 0.0 && _result.jacobian_deviation == 0.0 &&
+                        _result.static_allocations == 0;
+
+    if (_options.json) {
+        printf("{\"scenario\": \"static\", \"seed\": %u, \"states\": %u, \"rounds\": %u, "
+               "\"dynamic_forward_ns\": %.2f, \"static_forward_ns\": %.2f, "
+               "\"dynamic_jacobian_ns\": %.2f, \"static_jacobian_ns\": %.2f, "
+               "\"static_allocations\": %llu, \"forward_deviation\": %.3e, \"jacobian_deviation\": %.3e, "
+               "\"passed\": %s}\n",
+               _options.seed, _result.n_states, _result.n_rounds,
+               _result.dynamic_forward_ns, _result.static_forward_ns,
+               _result.dynamic_jacobian_ns, _result.static_jacobian_ns,
+               _result.static_allocations, _result.forward_deviation, _result.jacobian_deviation,
+               passed ? "true" : "false");
+        return passed;
+    }
+
+    printf("scenario            static, viewer chain (seed %u)\n", _options.seed);
+    printf("evaluations         %u states x %u rounds\n", _result.n_states, _result.n_rounds);
+    printf("forward             dynamic %.1f ns, static %.1f ns (%.2fx)\n",
+           _result.dynamic_forward_ns, _result.static_forward_ns, _result.dynamic_forward_ns / _result.static_forward_ns);
+    printf("jacobian            dynamic %.1f ns, static %.1f ns (%.2fx)\n",
+           _result.dynamic_jacobian_ns, _result.static_jacobian_ns, _result.dynamic_jacobian_ns / _result.static_jacobian_ns);
+    printf("static allocations  %llu\n", _result.static_allocations);
+    printf("deviation           forward %.3e, jacobian %.3e\n", _result.forward_deviation, _result.jacobian_deviation);
+    printf("check               %s, identical results without allocations\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+// the glmath kernels are out of line in the library, so are the references
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+/// the scalar loops glmath.cpp used before the SIMD kernels, as reference
+BENCH_NOINLINE static mat4 reference_product(const mat4& _m0, const mat4& _m1)
+{
+    mat4 m;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            m(i,j) = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                m(i,j) += _m0(i,k) * _m1(k,j);
+            }
+        }
+    }
+    return m;
+}
+
+BENCH_NOINLINE static vec4 reference_product(const mat4& _m, const vec4& _v)
+{
+    vec4 v;
+    for (int i = 0; i < 4; i++) {
+        v[i] = 0.0f;
+        for (int j = 0; j < 4; j++) {
+            v[i] += _m(i,j) * _v[j];
+        }
+    }
+    return v;
+}
+
+
+BENCH_NOINLINE static mat4 reference_transpose(const mat4& _m)
+{
+    mat4 mt;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            mt(i,j) = _m(j,i);
+        }
+    }
+    return mt;
+}
+
+
+/// per kernel: time of glmath and of the scalar reference, largest deviation, absolute
+/// and in units in the last place. The kernels promise bit-identical results
+struct Kernel_result
+{
+    const char* name;
+    double glmath_ns;
+    double reference_ns;
+    double deviation;
+    long long ulps;
+};
+
+
+struct Glmath_result
+{
+    unsigned int n_inputs = 0;
+    unsigned int n_rounds = 0;
+    std::vector<Kernel_result> kernels;
+};
+
+
+/// times _op over all inputs for the given number of rounds, in ns per call. The rounds
+/// are split into 5 repetitions and the fastest one counts, it is the least disturbed
+template<typename Op>
+static double time_kernel(unsigned int _n_inputs, unsigned int _n_rounds, Op _op)
+{
+    typedef std::chrono::steady_clock clock;
+    for (unsigned int i = 0; i < _n_inputs; i++) {
+        _op(i);
+    }
+    const unsigned int n_repetitions = 5;
+    const unsigned int n_rounds = std::max(1u, _n_rounds / n_repetitions);
+    double best = 1e30;
+    for (unsigned int k = 0; k < n_repetitions; k++) {
+        clock::time_point start = clock::now();
+        for (unsigned int r = 0; r < n_rounds; r++) {
+            for (unsigned int i = 0; i < _n_inputs; i++) {
+                _op(i);
+            }
+        }
+        best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+    }
+    return 1e9 * best / ((double)_n_inputs * n_rounds);
+}
+
+
+/// distance of two floats in units in the last place, 0 only for equal values
+static long long ulp_distance(float _a, float _b)
+{
+    int32_t a, b;
+    memcpy(&a, &_a, sizeof(a));
+    memcpy(&b, &_b, sizeof(b));
+    // sign and magnitude to a monotonic integer order, -0 and +0 both become 0
+    const long long ia = a < 0 ? -(long long)(a & 0x7fffffff) : a;
+    const long long ib = b < 0 ? -(long long)(b & 0x7fffffff) : b;
+    return ia > ib ? ia - ib : ib - ia;
+}
+
+
+/// folds the difference of _a and _b into the deviation of _kernel
+static void compare_kernel(float _a, float _b, Kernel_result& _kernel)
+{
+    _kernel.deviation = std::max(_kernel.deviation, (double)std::abs(_a - _b));
+    _kernel.ulps = std::max(_kernel.ulps, ulp_distance(_a, _b));
+}
+
+
+/// the glmath kernels against the scalar reference loops, on random input
+static Glmath_result run_glmath(const Options& _options)
+{
+    Glmath_result result;
+    result.n_inputs = _options.n_targets;
+    result.n_rounds = 200;
+    const unsigned int n = result.n_inputs;
+
+    std::mt19937 rng(_options.seed);
+    std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+
+    std::vector<mat4> m0(n), m1(n);
+    std::vector<vec4> v(n);
+    for (unsigned int i = 0; i < n; i++) {
+        for (int k = 0; k < 16; k++) {
+            m0[i](k % 4, k / 4) = value(rng);
+            m1[i](k % 4, k / 4) = value(rng);
+        }
+        v[i] = vec4(value(rng), value(rng), value(rng), value(rng));
+    }
+
+    std::vector<mat4> out4(n);
+    std::vector<vec4> outv(n);
+
+    Kernel_result mm = {"mat4 * mat4", 0.0, 0.0, 0.0, 0};
+    mm.glmath_ns    = time_kernel(n, result.n_rounds, [&](unsigned int i) { out4[i] = m0[i] * m1[i]; });
+    mm.reference_ns = time_kernel(n, result.n_rounds, [&](unsigned int i) { out4[i] = reference_product(m0[i], m1[i]); });
+    for (unsigned int i = 0; i < n; i++) {
+        mat4 a = m0[i] * m1[i], b = reference_product(m0[i], m1[i]);
+        for (int k = 0; k < 16; k++) {
+            compare_kernel(a.data()[k], b.data()[k], mm);
+        }
+    }
+    result.kernels.push_back(mm);
+
+    Kernel_result mv = {"mat4 * vec4", 0.0, 0.0, 0.0, 0};
+    mv.glmath_ns    = time_kernel(n, result.n_rounds, [&](unsigned int i) { outv[i] = m0[i] * v[i]; });
+    mv.reference_ns = time_kernel(n, result.n_rounds, [&](unsigned int i) { outv[i] = reference_product(m0[i], v[i]); });
+    for (unsigned int i = 0; i < n; i++) {
+        vec4 a = m0[i] * v[i], b = reference_product(m0[i], v[i]);
+        for (int k = 0; k < 4; k++) {
+            compare_kernel(a[k], b[k], mv);
+        }
+    }
+    result.kernels.push_back(mv);
+
+    Kernel_result tr = {"transpose(mat4)", 0.0, 0.0, 0.0, 0};
+    tr.glmath_ns    = time_kernel(n, result.n_rounds, [&](unsigned int i) { out4[i] = transpose(m0[i]); });
+    tr.reference_ns = time_kernel(n, result.n_rounds, [&](unsigned int i) { out4[i] = reference_transpose(m0[i]); });
+    for (unsigned int i = 0; i < n; i++) {
+        mat4 a = transpose(m0[i]), b = reference_transpose(m0[i]);
+        for (int k = 0; k < 16; k++) {
+            compare_kernel(a.data()[k], b.data()[k], tr);
+        }
+    }
+    result.kernels.push_back(tr);
+
+    // keeps the timed results alive
+    float sink = out4[n - 1](0,0) + outv[n - 1][0];
+    if (sink == 12345.0f) printf(" ");
+    return result;
+}
+
+
+/// prints the result, returns false if a kernel is not bit-identical to its reference
+static bool print_glmath_result(const Options& _options, const Glmath_result& _result)
+{
+    bool passed = true;
+    for (const Kernel_result& k : _result.kernels) {
+        passed = passed && k.ulps == 0;
+    }
+
+    if (_options.json) {
+        printf("{\"scenario\": \"glmath\", \"backend\": \"%s\", \"seed\": %u, \"inputs\": %u, \"rounds\": %u, "
+               "\"passed\": %s, \"kernels\": [",
+               GLMATH_SIMD, _options.seed, _result.n_inputs, _result.n_rounds, passed ? "true" : "false");
+        for (size_t i = 0; i < _result.kernels.size(); i++) {
+            const Kernel_result& k = _result.kernels[i];
+            printf("%s{\"name\": \"%s\", \"glmath_ns\": %.2f, \"reference_ns\": %.2f, \"deviation\": %.3e, \"ulps\": %lld}",
+                   i ? ", " : "", k.name, k.glmath_ns, k.reference_ns, k.deviation, k.ulps);
+        }
+        printf("]}\n");
+        return passed;
+    }
+
+    printf("scenario            glmath, %s backend (seed %u)\n", GLMATH_SIMD, _options.seed);
+    printf("evaluations         %u inputs x %u rounds, best of 5\n", _result.n_inputs, _result.n_rounds);
+    for (const Kernel_result& k : _result.kernels) {
+        printf("%-19s glmath %.1f ns, scalar %.1f ns (%.2fx), deviation %.3e, %lld ulps%s\n",
+               k.name, k.glmath_ns, k.reference_ns, k.reference_ns / k.glmath_ns, k.deviation, k.ulps,
+               k.ulps == 0 ? "" : "  FAILED");
+    }
+    printf("check               %s, bit-identical to the scalar loops\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+struct Sampling_result
+{
+    unsigned int n_targets = 0;
+    unsigned int n_rounds = 0;
+    /// time to produce one set of targets
+    double reference_ns = 0.0;
+    double trajectory_ns = 0.0;
+    /// time of one Trajectory::at() query
+    double query_ns = 0.0;
+    /// longest over shortest distance between consecutive targets, 1 is constant speed
+    double reference_spacing = 0.0;
+    double trajectory_spacing = 0.0;
+    /// largest distance of a Trajectory target to the exact curve, and of the
+    /// Trajectory of a PiecewiseBezier to the spline
+    double curve_deviation = 0.0;
+    double spline_deviation = 0.0;
+    /// time to evaluate the points and tangents of one spline path, per point and with
+    /// PiecewiseBezier::evaluate_range, and the largest difference between the two
+    unsigned int n_path_points = 0;
+    double pointwise_path_ns = 0.0;
+    double range_path_ns = 0.0;
+    double range_deviation = 0.0;
+};
+
+
+/// longest over shortest distance between consecutive targets
+static double spacing_ratio(const std::vector<vec4>& _targets)
+{
+    double shortest = 1e30, longest = 0.0;
+    for (size_t i = 1; i < _targets.size(); i++) {
+        const double d = norm(vec3(_targets[i]) - vec3(_targets[i - 1]));
+        shortest = std::min(shortest, d);
+        longest = std::max(longest, d);
+    }
+    return longest / shortest;
+}
+
+
+/// largest distance of the _points to the polyline through the _curve samples
+static double polyline_distance(const std::vector<vec3>& _curve, const std::vector<vec4>& _points)
+{
+    double deviation = 0.0;
+    for (const vec4& q : _points) {
+        const vec3 p(q);
+        double best = 1e30;
+        for (size_t i = 1; i < _curve.size(); i++) {
+            const vec3 d = _curve[i] - _curve[i - 1];
+            const float f = std::min(1.0f, std::max(0.0f, dot(p - _curve[i - 1], d) / std::max(dot(d, d), 1e-12f)));
+            best = std::min(best, (double)norm(_curve[i - 1] + f * d - p));
+        }
+        deviation = std::max(deviation, best);
+    }
+    return deviation;
+}
+
+
+/// targets along the viewer's Bezier curve, per point evaluation against Trajectory
+static Sampling_result run_sampling(const Options& _options)
+{
+    Sampling_result result;
+    result.n_targets = _options.n_targets;
+    result.n_rounds = 200;
+
+    const vec4 p0(0.0f, 4.5f, 0.0f, 1.0f), p1(-1.0f, 3.0f, 0.0f, 1.0f), p2(4.0f, 2.5f, 0.0f, 1.0f), p3(2.0f, 1.5f, 0.0f, 1.0f);
+    typedef std::chrono::steady_clock clock;
+    float sink = 0.0f;
+
+    clock::time_point start = clock::now();
+    std::vector<vec4> reference;
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        reference = reference_cubic_bezier(p0, p1, p2, p3, result.n_targets);
+        sink += reference[1][0];
+    }
+    result.reference_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / result.n_rounds;
+
+    start = clock::now();
+    std::vector<vec4> targets;
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        Trajectory curve;
+        curve.set_cubic(vec3(p0), vec3(p1), vec3(p2), vec3(p3));
+        curve.sample(result.n_targets, targets);
+        sink += targets[1][0];
+    }
+    result.trajectory_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / result.n_rounds;
+
+    Trajectory curve;
+    curve.set_cubic(vec3(p0), vec3(p1), vec3(p2), vec3(p3));
+    std::mt19937 rng(_options.seed);
+    std::uniform_real_distribution<float> fraction(0.0f, 1.0f);
+    std::vector<float> queries(4096);
+    for (float& u : queries) {
+        u = fraction(rng);
+    }
+    start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        for (float u : queries) {
+            sink += curve.at(u)[0];
+        }
+    }
+    result.query_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / ((double)result.n_rounds * queries.size());
+
+    result.reference_spacing = spacing_ratio(reference);
+    result.trajectory_spacing = spacing_ratio(targets);
+
+    // the exact curve, densely evaluated
+    std::vector<vec3> exact;
+    for (int i = 0; i <= 20000; i++) {
+        const float t = i / 20000.0f, s = 1.0f - t;
+        exact.push_back(s * s * s * vec3(p0) + 3.0f * s * s * t * vec3(p1) + 3.0f * s * t * t * vec3(p2) + t * t * t * vec3(p3));
+    }
+    result.curve_deviation = polyline_distance(exact, targets);
+
+    // a closed spline through random points
+    std::uniform_real_distribution<float> coordinate(-3.0f, 3.0f);
+    std::vector<vec3> polygon(8);
+    for (vec3& p : polygon) {
+        p = vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+    }
+    PiecewiseBezier spline;
+    spline.set_control_polygon(polygon, true);
+    std::vector<vec3> spline_points;
+    for (int i = 0; i <= 20000; i++) {
+        spline_points.push_back(spline(i / 20000.0f));
+    }
+    Trajectory spline_curve;
+    spline_curve.set_bezier(spline.bezier_control_points());
+    result.spline_deviation = polyline_distance(spline_points, spline_curve.sample(result.n_targets));
+
+    // regenerating the preview of a path, positions and tangents of a Path's 1000 points
+    result.n_path_points = 1000;
+    const unsigned int n = result.n_path_points;
+    std::vector<vec3> positions(n), tangents(n), range_positions(n), range_tangents(n);
+    start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        for (unsigned int i = 0; i < n; i++) {
+            const float t = i / float(n - 1);
+            positions[i] = spline(t);
+            tangents[i] = spline.tangent(t);
+        }
+        sink += positions[1][0] + tangents[1][0];
+    }
+    result.pointwise_path_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / result.n_rounds;
+
+    start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        spline.evaluate_range(0.0f, 1.0f, n, range_positions.data(), range_tangents.data());
+        sink += range_positions[1][0] + range_tangents[1][0];
+    }
+    result.range_path_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / result.n_rounds;
+
+    for (unsigned int i = 0; i < n; i++) {
+        result.range_deviation = std::max(result.range_deviation, (double)norm(positions[i] - range_positions[i]));
+        result.range_deviation = std::max(result.range_deviation, (double)norm(tangents[i] - range_tangents[i]));
+    }
+
+    if (sink == 12345.0f) printf(" ");
+    return result;
+}
+
+
+/// prints the result, returns false unless the Trajectory targets have constant spacing and
+/// the curve, the spline and evaluate_range() stay within their tolerances
+static bool print_sampling_result(const Options& _options, const Sampling_result& _result)
+{
+    // arc length tables of single precision points, the spline goes through a polyline
+    const bool passed = _result.trajectory_spacing <= 1.01 && _result.curve_deviation <= 5e-4 &&
+                        _result.spline_deviation <= 2e-3 && _result.range_deviation <= 1e-4;
+
+    if (_options.json) {
+        printf("{\"scenario\": \"sampling\", \"targets\": %u, \"rounds\": %u, "
+               "\"reference_ns\": %.1f, \"trajectory_ns\": %.1f, \"query_ns\": %.2f, "
+               "\"reference_spacing\": %.3f, \"trajectory_spacing\": %.3f, "
+               "\"curve_deviation\": %.3e, \"spline_deviation\": %.3e, \"path_points\": %u, "
+               "\"pointwise_path_ns\": %.1f, \"range_path_ns\": %.1f, \"range_deviation\": %.3e, \"passed\": %s}\n",
+               _result.n_targets, _result.n_rounds, _result.reference_ns, _result.trajectory_ns, _result.query_ns,
+               _result.reference_spacing, _result.trajectory_spacing, _result.curve_deviation, _result.spline_deviation,
+               _result.n_path_points, _result.pointwise_path_ns, _result.range_path_ns, _result.range_deviation,
+               passed ? "true" : "false");
+        return passed;
+    }
+
+    printf("scenario            sampling, %u targets on a cubic Bezier curve\n", _result.n_targets);
+    printf("targets             per point %.1f us, trajectory %.1f us (%.2fx)\n",
+           1e-3 * _result.reference_ns, 1e-3 * _result.trajectory_ns, _result.reference_ns / _result.trajectory_ns);
+    printf("query               %.2f ns per Trajectory::at()\n", _result.query_ns);
+    printf("spacing max/min     per point %.3f, trajectory %.3f\n", _result.reference_spacing, _result.trajectory_spacing);
+    printf("deviation           curve %.3e, spline %.3e\n", _result.curve_deviation, _result.spline_deviation);
+    printf("spline path         %u points and tangents: per point %.1f us, evaluate_range %.1f us (%.2fx), deviation %.3e\n",
+           _result.n_path_points, 1e-3 * _result.pointwise_path_ns, 1e-3 * _result.range_path_ns,
+           _result.pointwise_path_ns / _result.range_path_ns, _result.range_deviation);
+    printf("check               %s\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+struct Timing_result
+{
+    unsigned int n_samples = 0;
+    unsigned int n_rounds = 0;
+    float max_velocity = 0.0f;
+    float max_acceleration = 0.0f;
+    /// time of one Time_parameterization::compute(), of _n_samples and of four times as many samples
+    double compute_ns = 0.0;
+    double compute_4x_ns = 0.0;
+    /// time from the start to the end of the path, with the schedule and one target per 60 Hz frame
+    double duration = 0.0;
+    double frame_duration = 0.0;
+    /// largest joint velocity and acceleration over its limit, measured on the
+    /// samples, with the schedule and one target per frame
+    double velocity_ratio = 0.0;
+    double acceleration_ratio = 0.0;
+    double frame_velocity_ratio = 0.0;
+    double frame_acceleration_ratio = 0.0;
+    /// a path of two samples, one DOF turning 10 degrees: the duration of its schedule
+    /// and that of accelerating to the middle and braking after it, 2 sqrt(10 / max_acceleration)
+    double segment_duration = 0.0;
+    double segment_expected = 0.0;
+    /// the sample times increase strictly and the position along the path never goes back
+    bool monotone = false;
+};
+
+
+/// the schedule of a two sample path may be off by this fraction of its duration
+static const double segment_tolerance = 1e-3;
+/// the schedule may exceed the joint limits by this fraction, the ratios are measured
+/// by differences of IK solutions, which are only accurate to the solver tolerance
+static const double timing_limit_tolerance = 0.05;
+
+
+/// the viewer's arm and its path, IK-solved at _n targets equally spaced along the path.
+/// Writes the arc length of every target to _s and the DOF values to _dof_path
+static void solve_viewer_path(unsigned int _n, std::vector<float>& _s, std::vector<float>& _dof_path)
+{
+    Kinematics chain;
+    chain.add_joint(Joint::ball());
+    chain.add_joint(Joint::bone(2.0f));
+    chain.add_joint(Joint::hinge());
+    chain.add_joint(Joint::bone(1.5f));
+    chain.add_joint(Joint::axial());
+    chain.set_limits(2, -150.0f, 150.0f);
+    chain.set_limit_handling(CLAMP_DOFS);
+    chain.set_objective_weight(MANIPULABILITY, 0.05f);
+
+    Trajectory path;
+    path.set_cubic(chain.end_effector().translation_, vec3(-1.0f, 3.0f, 0.0f), vec3(4.0f, 2.5f, 0.0f), vec3(2.0f, 1.5f, 0.0f));
+    Solve_options options;
+    options.tolerance = 1e-4f;
+    options.max_iterations = 200;
+
+    _s.resize(_n);
+    _dof_path.clear();
+    for (unsigned int i = 0; i < _n; i++) {
+        _s[i] = path.length() * i / (_n - 1);
+        chain.solve(vec4(path.at_distance(_s[i]), 1.0f), options);
+        const std::vector<float> values = chain.dof_values();
+        _dof_path.insert(_dof_path.end(), values.begin(), values.end());
+    }
+}
+
+
+/// largest joint velocity and acceleration over the limits when the samples of _dof_path
+/// are passed at _times, by differences over every 8 samples: the IK solutions are only
+/// accurate to the tolerance, second differences of neighbouring samples measure their noise
+static void limit_ratios(const std::vector<float>& _times, const std::vector<float>& _dof_path, const Timing_result& _result,
+                         double& _velocity_ratio, double& _acceleration_ratio)
+{
+    const size_t n = _times.size();
+    const size_t d = _dof_path.size() / n;
+    const size_t k = 8;
+    _velocity_ratio = 0.0;
+    _acceleration_ratio = 0.0;
+    for (size_t i = 0; i + k < n; i++) {
+        const double dt = _times[i + k] - _times[i];
+        for (size_t j = 0; j < d; j++) {
+            const double v = (_dof_path[(i + k) * d + j] - _dof_path[i * d + j]) / dt;
+            _velocity_ratio = std::max(_velocity_ratio, fabs(v) / _result.max_velocity);
+            if (i + 2 * k < n) {
+                const double dt1 = _times[i + 2 * k] - _times[i + k];
+                const double v1 = (_dof_path[(i + 2 * k) * d + j] - _dof_path[(i + k) * d + j]) / dt1;
+                _acceleration_ratio = std::max(_acceleration_ratio, fabs(v1 - v) / (0.5 * (dt + dt1)) / _result.max_acceleration);
+            }
+        }
+    }
+}
+
+
+/// time optimal schedule of the viewer's path against one target per frame
+static Timing_result run_timing(const Options& _options)
+{
+    Timing_result result;
+    result.n_samples = _options.n_targets;
+    result.n_rounds = 200;
+    result.max_velocity = 90.0f;
+    result.max_acceleration = 360.0f;
+
+    std::vector<float> s, dof_path, s_4x, dof_path_4x;
+    solve_viewer_path(result.n_samples, s, dof_path);
+    solve_viewer_path(4 * result.n_samples, s_4x, dof_path_4x);
+    const size_t n_dofs = dof_path.size() / result.n_samples;
+
+    Time_parameterization timing;
+    const std::vector<float> max_velocity(n_dofs, result.max_velocity);
+    const std::vector<float> max_acceleration(n_dofs, result.max_acceleration);
+    timing.set_limits(Span<const float>(max_velocity.data(), n_dofs), Span<const float>(max_acceleration.data(), n_dofs));
+
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        timing.compute(s_4x, dof_path_4x);
+    }
+    result.compute_4x_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / result.n_rounds;
+
+    start = clock::now();
+    bool feasible = true;
+    for (unsigned int r = 0; r < result.n_rounds; r++) {
+        feasible = timing.compute(s, dof_path) && feasible;
+    }
+    result.compute_ns = 1e9 * std::chrono::duration<double>(clock::now() - start).count() / result.n_rounds;
+    if (!feasible) {
+        fprintf(stderr, "the path cannot be traversed within the limits\n");
+    }
+
+    result.duration = timing.duration();
+    limit_ratios(timing.times(), dof_path, result, result.velocity_ratio, result.acceleration_ratio);
+
+    result.monotone = feasible;
+    const std::vector<float>& times = timing.times();
+    for (size_t i = 1; i < times.size(); i++) {
+        result.monotone = result.monotone && times[i] > times[i - 1];
+    }
+    float position = timing.position(0.0f);
+    for (float t = 0.0f; t <= result.duration + 0.01f; t += 0.001f) {
+        const float next = timing.position(t);
+        result.monotone = result.monotone && next >= position;
+        position = next;
+    }
+    result.monotone = result.monotone && position == s.back();
+
+    std::vector<float> frame_times(result.n_samples);
+    for (unsigned int i = 0; i < result.n_samples; i++) {
+        frame_times[i] = i / 60.0f;
+    }
+    result.frame_duration = frame_times.back();
+    limit_ratios(frame_times, dof_path, result, result.frame_velocity_ratio, result.frame_acceleration_ratio);
+
+    // slow enough that the velocity limit is not reached, 60 of 90 deg/s
+    Time_parameterization segment;
+    const float segment_velocity = result.max_velocity;
+    const float segment_acceleration = result.max_acceleration;
+    segment.set_limits(Span<const float>(&segment_velocity, 1), Span<const float>(&segment_acceleration, 1));
+    const std::vector<float> segment_s = {0.0f, 1.0f};
+    const std::vector<float> segment_path = {0.0f, 10.0f};
+    result.segment_duration = segment.compute(segment_s, segment_path) ? segment.duration() : 0.0;
+    result.segment_expected = 2.0 * sqrt(10.0 / result.max_acceleration);
+    return result;
+}
+
+
+/// prints the result, returns false if the schedule is not monotone, exceeds the limits or
+/// does not schedule the two sample path as expected
+static bool print_timing_result(const Options& _options, const Timing_result& _result)
+{
+    const bool passed = fabs(_result.segment_duration - _result.segment_expected) <= segment_tolerance * _result.segment_expected &&
+                        _result.monotone && _result.velocity_ratio <= 1.0 + timing_limit_tolerance &&
+                        _result.acceleration_ratio <= 1.0 + timing_limit_tolerance;
+
+    if (_options.json) {
+        printf("{\"scenario\": \"timing\", \"samples\": %u, \"rounds\": %u, \"max_velocity\": %.1f, "
+               "\"max_acceleration\": %.1f, \"compute_ns\": %.1f, \"compute_4x_ns\": %.1f, "
+               "\"duration\": %.4f, \"frame_duration\": %.4f, \"velocity_ratio\": %.3f, "
+               "\"acceleration_ratio\": %.3f, \"frame_velocity_ratio\": %.3f, \"frame_acceleration_ratio\": %.3f, "
+               "\"segment_duration\": %.4f, \"segment_expected\": %.4f, \"monotone\": %s, \"passed\": %s}\n",
+               _result.n_samples, _result.n_rounds, _result.max_velocity, _result.max_acceleration,
+               _result.compute_ns, _result.compute_4x_ns, _result.duration, _result.frame_duration,
+               _result.velocity_ratio, _result.acceleration_ratio, _result.frame_velocity_ratio,
+               _result.frame_acceleration_ratio, _result.segment_duration, _result.segment_expected,
+               _result.monotone ? "true" : "false", passed ? "true" : "false");
+        return passed;
+    }
+
+    printf("scenario            timing, viewer path with %u samples, limits %.0f deg/s and %.0f deg/s^2\n",
+           _result.n_samples, _result.max_velocity, _result.max_acceleration);
+    printf("compute             %.1f us, %.1f ns per sample; %u samples %.1f ns per sample\n",
+           1e-3 * _result.compute_ns, _result.compute_ns / _result.n_samples,
+           4 * _result.n_samples, _result.compute_4x_ns / (4 * _result.n_samples));
+    printf("schedule            %.3f s, velocity %.3f, acceleration %.3f of the limits, %s\n",
+           _result.duration, _result.velocity_ratio, _result.acceleration_ratio,
+           _result.monotone ? "monotone" : "NOT MONOTONE");
+    printf("target per frame    %.3f s, velocity %.3f, acceleration %.3f of the limits\n",
+           _result.frame_duration, _result.frame_velocity_ratio, _result.frame_acceleration_ratio);
+    printf("two samples         %.4f s, expected %.4f s\n", _result.segment_duration, _result.segment_expected);
+    printf("check               %s\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+struct Mesh_result
+{
+    const char* name = "";
+    unsigned int n_vertices = 0;
+    unsigned int n_triangles = 0;
+    /// FIFO cache miss ratio of 16 and 32 entries, in generation order and after optimize_vertex_cache()
+    double acmr_16 = 0.0;
+    double acmr_32 = 0.0;
+    double optimized_acmr_16 = 0.0;
+    double optimized_acmr_32 = 0.0;
+    double optimize_us = 0.0;
+    /// bytes of the three float vertex buffers and 32 bit indices, and of the packed buffers
+    size_t separate_bytes = 0;
+    size_t packed_bytes = 0;
+    unsigned int stride = 0;
+    unsigned int index_size = 0;
+    /// largest difference between the float and the packed half float normals
+    double normal_error = 0.0;
+    /// the optimized mesh has the same triangles, up to the numbering of the vertices
+    bool same_triangles = false;
+};
+
+
+/// half float _h as float, normal numbers and zero only
+static float half_to_float(uint16_t _h)
+{
+    const int exponent = (_h >> 10) & 0x1f;
+    const float mantissa = 1.0f + (_h & 0x3ff) / 1024.0f;
+    const float value = exponent == 0 ? 0.0f : ldexpf(mantissa, exponent - 15);
+    return (_h & 0x8000) ? -value : value;
+}
+
+
+/// the triangles of _mesh as sorted lists of their corner positions
+static std::vector<std::vector<float> > triangle_positions(const Mesh_builder& _mesh)
+{
+    Mesh_builder packed = _mesh;
+    packed.pack(FLOAT_VERTICES);
+    const std::vector<uint8_t>& data = packed.vertex_data();
+    std::vector<std::vector<float> > triangles;
+    for (size_t t = 0; t < _mesh.n_indices(); t += 3) {
+        std::vector<float> corners;
+        for (size_t k = 0; k < 3; k++) {
+            float p[3];
+            memcpy(p, &data[_mesh.indices()[t + k] * packed.stride()], sizeof(p));
+            corners.insert(corners.end(), p, p + 3);
+        }
+        // rotate the corners to start at the smallest, keeping the winding
+        size_t first = 0;
+        for (size_t k = 1; k < 3; k++) {
+            if (std::lexicographical_compare(&corners[3 * k], &corners[3 * k + 3], &corners[3 * first], &corners[3 * first + 3])) first = k;
+        }
+        std::rotate(corners.begin(), corners.begin() + 3 * first, corners.end());
+        triangles.push_back(corners);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+
+static Mesh_result run_mesh(const char* _name, const Mesh_builder& _mesh)
+{
+    Mesh_result result;
+    result.name = _name;
+    result.n_vertices = (unsigned int)_mesh.n_vertices();
+    result.n_triangles = (unsigned int)_mesh.n_indices() / 3;
+    result.acmr_16 = _mesh.acmr(16);
+    result.acmr_32 = _mesh.acmr(32);
+    result.separate_bytes = _mesh.n_vertices() * (3 + 3 + 2) * sizeof(float) + _mesh.n_indices() * 4;
+
+    const unsigned int n_rounds = 20;
+    Mesh_builder optimized;
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+    for (unsigned int r = 0; r < n_rounds; r++) {
+        optimized = _mesh;
+        optimized.optimize_vertex_cache();
+    }
+    result.optimize_us = 1e6 * std::chrono::duration<double>(clock::now() - start).count() / n_rounds;
+    result.optimized_acmr_16 = optimized.acmr(16);
+    result.optimized_acmr_32 = optimized.acmr(32);
+    result.same_triangles = triangle_positions(_mesh) == triangle_positions(optimized);
+
+    Mesh_builder reference = optimized;
+    reference.pack(FLOAT_VERTICES);
+    optimized.pack(HALF_VERTICES);
+    result.packed_bytes = optimized.vertex_data().size() + optimized.index_data().size();
+    result.stride = optimized.stride();
+    result.index_size = optimized.index_size();
+    for (size_t v = 0; v < optimized.n_vertices(); v++) {
+        float normal[3];
+        uint16_t half[3];
+        memcpy(normal, &reference.vertex_data()[v * reference.stride() + reference.normal_offset()], sizeof(normal));
+        memcpy(half, &optimized.vertex_data()[v * optimized.stride() + optimized.normal_offset()], sizeof(half));
+        for (size_t k = 0; k < 3; k++) {
+            result.normal_error = std::max(result.normal_error, (double)fabsf(normal[k] - half_to_float(half[k])));
+        }
+    }
+    return result;
+}
+
+
+/// true if the packing keeps the triangles, does not make the vertex cache order worse,
+/// shrinks the buffers and rounds the normals to half float precision, 2^-11 relative
+static bool check_mesh(const Mesh_result& _result)
+{
+    return _result.same_triangles && _result.optimized_acmr_16 <= _result.acmr_16 &&
+           _result.packed_bytes < _result.separate_bytes && _result.normal_error <= 1.0 / 2048.0;
+}
+
+
+/// prints one mesh, as an element of the "meshes" array for JSON output
+static void print_mesh_result(const Options& _options, const Mesh_result& _result, bool _first)
+{
+    if (_options.json) {
+        printf("%s{\"name\": \"%s\", \"vertices\": %u, \"triangles\": %u, "
+               "\"acmr_16\": %.3f, \"acmr_32\": %.3f, \"optimized_acmr_16\": %.3f, \"optimized_acmr_32\": %.3f, "
+               "\"optimize_us\": %.1f, \"separate_bytes\": %zu, \"packed_bytes\": %zu, \"stride\": %u, "
+               "\"index_size\": %u, \"normal_error\": %.3e, \"same_triangles\": %s, \"passed\": %s}",
+               _first ? "" : ", ", _result.name, _result.n_vertices, _result.n_triangles, _result.acmr_16, _result.acmr_32,
+               _result.optimized_acmr_16, _result.optimized_acmr_32, _result.optimize_us,
+               _result.separate_bytes, _result.packed_bytes, _result.stride, _result.index_size,
+               _result.normal_error, _result.same_triangles ? "true" : "false", check_mesh(_result) ? "true" : "false");
+        return;
+    }
+
+    printf("mesh                %s, %u vertices, %u triangles\n", _result.name, _result.n_vertices, _result.n_triangles);
+    printf("acmr 16 / 32        %.3f / %.3f generated, %.3f / %.3f optimized in %.1f us%s\n",
+           _result.acmr_16, _result.acmr_32, _result.optimized_acmr_16, _result.optimized_acmr_32,
+           _result.optimize_us, _result.same_triangles ? "" : ", TRIANGLES DIFFER");
+    printf("buffers             %zu bytes separate, %zu bytes packed (%.2fx), %u bytes per vertex, %u bit indices, normal error %.2e\n",
+           _result.separate_bytes, _result.packed_bytes, (double)_result.separate_bytes / _result.packed_bytes,
+           _result.stride, 8 * _result.index_size, _result.normal_error);
+    printf("check               %s\n", check_mesh(_result) ? "passed" : "FAILED");
+}
+
+
+/// packs the viewer meshes and prints them, returns false if check_mesh() fails for one
+static bool run_meshes(const Options& _options)
+{
+    const Mesh_result meshes[] = {run_mesh("sphere 50", Mesh_builder::sphere(50)),
+                                  run_mesh("sphere 8", Mesh_builder::sphere(8)),
+                                  run_mesh("cylinder 50", Mesh_builder::cylinder(50))};
+    bool passed = true;
+    for (const Mesh_result& mesh : meshes) {
+        passed = passed && check_mesh(mesh);
+    }
+
+    if (_options.json) {
+        printf("{\"scenario\": \"mesh\", \"passed\": %s, \"meshes\": [", passed ? "true" : "false");
+    } else {
+        printf("scenario            mesh, viewer meshes in one interleaved buffer\n");
+    }
+    for (size_t i = 0; i < sizeof(meshes) / sizeof(meshes[0]); i++) {
+        print_mesh_result(_options, meshes[i], i == 0);
+    }
+    if (_options.json) {
+        printf("]}\n");
+    }
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+/// the checks of a trajectory, tree or batch result, the thresholds of _options and the ones
+/// that always hold: the DOFs within their limits, the cached frames equal to computed ones
+/// and the batch equal to serial solves. Prints every failed check to stderr
+static bool check_result(const Options& _options, const Result& _result)
+{
+    const double allocations_per_step = _result.n_steps ? (double)_result.n_allocations / _result.n_steps : 0.0;
+    bool passed = true;
+    if (_result.n_converged < _options.min_converged) {
+        fprintf(stderr, "check failed: %u targets converged, expected %u\n", _result.n_converged, _options.min_converged);
+        passed = false;
+    }
+    if (_options.max_allocations >= 0.0 && allocations_per_step > _options.max_allocations) {
+        fprintf(stderr, "check failed: %.3f allocations per step, expected at most %.3f\n",
+                allocations_per_step, _options.max_allocations);
+        passed = false;
+    }
+    if (_result.mean_manipulability < _options.min_manipulability) {
+        fprintf(stderr, "check failed: mean manipulability %.4f, expected at least %.4f\n",
+                _result.mean_manipulability, _options.min_manipulability);
+        passed = false;
+    }
+    // the limits are clamped in float DOF coordinates
+    if (_result.limit_violation > 1e-3) {
+        fprintf(stderr, "check failed: a DOF ends %.3e degrees outside its limits\n", _result.limit_violation);
+        passed = false;
+    }
+    if (_result.cache_deviation > 0.0) {
+        fprintf(stderr, "check failed: cached end effectors %.3e away from computed ones\n", _result.cache_deviation);
+        passed = false;
+    }
+    if (_result.n_serial_mismatches > 0) {
+        fprintf(stderr, "check failed: %u chains differ from serial solves\n", _result.n_serial_mismatches);
+        passed = false;
+    }
+    return passed;
+}
+
+
+/// prints the result, returns false if a check of check_result() fails
+static bool print_result(const Options& _options, unsigned int _n_dofs, const Result& _result)
+{
+    const bool passed = check_result(_options, _result);
+    double steps_per_second = _result.seconds > 0.0 ? _result.n_steps / _result.seconds : 0.0;
+    double allocations_per_step = _result.n_steps ? (double)_result.n_allocations / _result.n_steps : 0.0;
+    double us_per_converged = _result.n_converged ? 1e6 * _result.seconds / _result.n_converged : 0.0;
+    const char* jacobian = _options.jacobian_mode == ANALYTIC ? "analytic" : "fd";
+    const char* driver = _options.use_solve ? "solve" : "step";
+    const char* limit_handling = _options.limit_handling == CLAMP_DOFS ? "clamp" : "project";
+
+    if (_options.json) {
+        printf("{\"scenario\": \"%s\", \"driver\": \"%s\", \"solver\": \"%s\", \"jacobian\": \"%s\", "
+               "\"limits\": %.1f, \"limit_handling\": \"%s\", "
+               "\"depth\": %u, \"joints\": \"%s\", \"dofs\": %u, \"seed\": %u, \"targets\": %u, "
+               "\"steps\": %llu, \"seconds\": %.6f, \"steps_per_second\": %.1f, \"us_per_converged\": %.3f, "
+               "\"converged\": %u, \"mean_iterations\": %.3f, \"max_iterations\": %u, "
+               "\"mean_error\": %.3e, \"max_error\": %.3e, "
+               "\"allocations_per_step\": %.3f, \"jacobian_deviation\": %.3e, "
+               "\"line_search_evaluations\": %llu, \"stalled\": %u, "
+               "\"objective\": \"%s\", \"objective_weight\": %.3f, "
+               "\"mean_manipulability\": %.4f, \"min_manipulability\": %.4f, \"serial_mismatches\": %u, "
+               "\"limit_violation\": %.3e, \"cache_deviation\": %.3e, \"passed\": %s}\n",
+               _options.scenario.c_str(), driver, solver_name(_options.solver), jacobian,
+               _options.limits, limit_handling,
+               _options.depth, _options.joints.c_str(), _n_dofs, _options.seed, _result.n_targets,
+               _result.n_steps, _result.seconds, steps_per_second, us_per_converged,
+               _result.n_converged, _result.mean_iterations, _result.max_iterations,
+               _result.mean_error, _result.max_error,
+               allocations_per_step, _result.jacobian_deviation,
+               _result.n_line_search, _result.n_stalled,
+               _options.objective.c_str(), _options.objective_weight,
+               _result.mean_manipulability, _result.min_manipulability, _result.n_serial_mismatches,
+               _result.limit_violation, _result.cache_deviation, passed ? "true" : "false");
+        return passed;
+    }
+
+    printf("scenario            %s (seed %u)\n", _options.scenario.c_str(), _options.seed);
+    if (_options.scenario == "tree") {
+        printf("chain               torso and two arms, 2 end effectors, %u dofs\n", _n_dofs);
+    } else {
+        printf("chain               depth %u, %s joints, %u dofs\n", _options.depth, _options.joints.c_str(), _n_dofs);
+    }
+    if (_options.limits > 0.0f) {
+        printf("limits              +-%.1f degrees, %s\n", _options.limits, limit_handling);
+    }
+    printf("solver              %s, %s jacobian, %s driver\n", solver_name(_options.solver), jacobian, driver);
+    printf("steps               %llu in %.3f s, %.0f steps/s\n", _result.n_steps, _result.seconds, steps_per_second);
+    printf("converged           %u of %u targets, %.1f us per converged target\n",
+           _result.n_converged, _result.n_targets, us_per_converged);
+    printf("iterations          mean %.2f, max %u\n", _result.mean_iterations, _result.max_iterations);
+    printf("final error         mean %.3e, max %.3e\n", _result.mean_error, _result.max_error);
+    if (_options.objective != "none") {
+        printf("objective           %s, weight %.3f\n", _options.objective.c_str(), _options.objective_weight);
+    }
+    if (_options.scenario == "batch") {
+        printf("serial solves       %u of %u chains differ from the batch\n", _result.n_serial_mismatches, _result.n_targets);
+    }
+    if (_options.scenario != "batch") {
+        printf("manipulability      mean %.4f, min %.4f\n", _result.mean_manipulability, _result.min_manipulability);
+    }
+    if (_options.use_solve) {
+        printf("line search         %llu forward passes, %u targets stalled\n", _result.n_line_search, _result.n_stalled);
+    }
+    if (_options.limits > 0.0f) {
+        printf("limit violation     %.3e degrees\n", std::max(0.0, _result.limit_violation));
+    }
+    if (_options.scenario == "tree") {
+        printf("cache deviation     %.3e (cached vs computed end effectors)\n", _result.cache_deviation);
+    }
+    printf("allocations/step    %.3f (after the first target that took a step)\n", allocations_per_step);
+    printf("jacobian deviation  %.3e (analytic vs finite differences)\n", _result.jacobian_deviation);
+    printf("check               %s\n", passed ? "passed" : "FAILED");
+    return passed;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+static void usage()
+{
+    printf("usage: ik_bench [options]\n"
+           "  --scenario bezier|line|random|batch  target trajectory (default bezier), batch checks\n"
+           "                                       the batch against serial solves\n"
+           "  --scenario tree                      two arms with one end effector each\n"
+           "  --scenario pose                      check position and orientation targets\n"
+           "  --scenario jacobian                  check analytic against finite-difference Jacobians\n"
+           "  --scenario static                    compile-time vs. dynamic chain layout\n"
+           "  --scenario glmath                    SIMD glmath kernels vs. scalar loops\n"
+           "  --scenario sampling                  Bezier targets per point vs. Trajectory\n"
+           "  --scenario timing                    time optimal schedule of the viewer path\n"
+           "  --scenario mesh                      vertex cache order and packing of the meshes\n"
+           "  --depth N                            number of joints (default 3)\n"
+           "  --joints mixed|ball|hinge|axial      rotational joints of the chain (default mixed)\n"
+           "  --solver pinv|dls|transpose|ccd|fabrik  (default dls)\n"
+           "  --jacobian analytic|fd               (default analytic)\n"
+           "  --driver step|solve                  step() per iteration or solve() per target (default step)\n"
+           "  --limits DEG                         limit every DOF to +-DEG (default 0, unlimited)\n"
+           "  --limit-handling clamp|project       (default clamp)\n"
+           "  --objective none|limits|rest|manipulability  null space objective (default none)\n"
+           "  --objective-weight W                 (default 0.1)\n"
+           "  --targets N                          number of targets (default 500)\n"
+           "  --max-iterations N                   per target (default 200)\n"
+           "  --tolerance T                        convergence distance (default 1e-3)\n"
+           "  --seed N                             random seed (default 1)\n"
+           "  --min-converged N                    fail if fewer targets converge (default 0)\n"
+           "  --max-allocations A                  fail above A allocations per step (default unchecked)\n"
+           "  --min-manipulability M               fail below a mean manipulability of M (default 0)\n"
+           "  --format text|json                   (default text)\n");
+}
+
+
+static bool parse_options(int _argc, char** _argv, Options& _options)
+{
+    for (int i = 1; i < _argc; i++) {
+        std::string arg = _argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= _argc) {
+            fprintf(stderr, "missing value for %s\n", arg.c_str());
+            return false;
+        }
+        std::string value = _argv[++i];
+
+        if (arg == "--scenario") {
+            if (value != "bezier" && value != "line" && value != "random" && value != "batch" && value != "tree"
+                && value != "pose"
+                && value != "static" && value != "jacobian"
+                && value != "glmath" && value != "sampling" && value != "timing"
+                && value != "mesh") {
+                fprintf(stderr, "unknown scenario %s\n", value.c_str());
+                return false;
+            }
+            _options.scenario = value;
+        }
+        else if (arg == "--depth") _options.depth = std::max(1, atoi(value.c_str()));
+        else if (arg == "--joints") {
+            if (value != "mixed" && value != "ball" && value != "hinge" && value != "axial") {
+                fprintf(stderr, "unknown joints %s\n", value.c_str());
+                return false;
+            }
+            _options.joints = value;
+        }
+        else if (arg == "--targets") _options.n_targets = std::max(2, atoi(value.c_str()));
+        else if (arg == "--max-iterations") _options.max_iterations = std::max(1, atoi(value.c_str()));
+        else if (arg == "--tolerance") _options.tolerance = (float)atof(value.c_str());
+        else if (arg == "--seed") _options.seed = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--min-converged") _options.min_converged = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--max-allocations") _options.max_allocations = atof(value.c_str());
+        else if (arg == "--min-manipulability") _options.min_manipulability = atof(value.c_str());
+        else if (arg == "--solver") {
+            if (value == "pinv") _options.solver = PSEUDO_INVERSE;
+            else if (value == "dls") _options.solver = DAMPED_LEAST_SQUARES;
+            else if (value == "transpose") _options.solver = JACOBIAN_TRANSPOSE;
+            else if (value == "ccd") _options.solver = CYCLIC_COORDINATE_DESCENT;
+            else if (value == "fabrik") _options.solver = FABRIK;
+            else {
+                fprintf(stderr, "unknown solver %s\n", value.c_str());
+                return false;
+            }
+        }
+        else if (arg == "--jacobian") {
+            if (value == "analytic") _options.jacobian_mode = ANALYTIC;
+            else if (value == "fd") _options.jacobian_mode = FINITE_DIFFERENCES;
+            else {
+                fprintf(stderr, "unknown jacobian mode %s\n", value.c_str());
+                return false;
+            }
+        }
+        else if (arg == "--driver") {
+            if (value != "step" && value != "solve") {
+                fprintf(stderr, "unknown driver %s\n", value.c_str());
+                return false;
+            }
+            _options.use_solve = value == "solve";
+        }
+        else if (arg == "--limits") _options.limits = std::max(0.0f, (float)atof(value.c_str()));
+        else if (arg == "--objective") {
+            if (value != "none" && value != "limits" && value != "rest" && value != "manipulability") {
+                fprintf(stderr, "unknown objective %s\n", value.c_str());
+                return false;
+            }
+            _options.objective = value;
+        }
+        else if (arg == "--objective-weight") _options.objective_weight = std::max(0.0f, (float)atof(value.c_str()));
+        else if (arg == "--limit-handling") {
+            if (value == "clamp") _options.limit_handling = CLAMP_DOFS;
+            else if (value == "project") _options.limit_handling = PROJECT_STATE;
+            else {
+                fprintf(stderr, "unknown limit handling %s\n", value.c_str());
+                return false;
+            }
+        }
+        else if (arg == "--format") {
+            if (value != "text" && value != "json") {
+                fprintf(stderr, "unknown format %s\n", value.c_str());
+                return false;
+            }
+            _options.json = value == "json";
+        }
+        else {
+            fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+//=============================================================================
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    if (options.scenario == "static") {
+        return print_static_result(options, run_static(options)) ? 0 : 1;
+    }
+    if (options.scenario == "jacobian") {
+        return print_jacobian_result(options, run_jacobian(options)) ? 0 : 1;
+    }
+    if (options.scenario == "glmath") {
+        return print_glmath_result(options, run_glmath(options)) ? 0 : 1;
+    }
+    if (options.scenario == "sampling") {
+        return print_sampling_result(options, run_sampling(options)) ? 0 : 1;
+    }
+    if (options.scenario == "timing") {
+        return print_timing_result(options, run_timing(options)) ? 0 : 1;
+    }
+    if (options.scenario == "mesh") {
+        return run_meshes(options) ? 0 : 1;
+    }
+
+    Kinematics chain;
+    if (options.scenario == "tree") {
+        build_tree(chain);
+    } else {
+        build_chain(chain, options.depth, options.joints);
+    }
+
+    // move away from the straight pose before comparing Jacobians
+    std::vector<float> pose(chain.n_dofs());
+    for (size_t i = 0; i < pose.size(); i++) {
+        pose[i] = 10.0f + 7.0f * i;
+    }
+    chain.set_dof_values(Span<const float>(pose.data(), pose.size()));
+    double deviation = jacobian_deviation(chain);
+    chain.reset();
+
+    chain.set_solver(options.solver);
+    chain.set_jacobian_mode(options.jacobian_mode);
+    if (options.limits > 0.0f) {
+        for (size_t i = 0; i < chain.n_joints(); i++) {
+            chain.set_limits(i, -options.limits, options.limits);
+        }
+        chain.set_limit_handling(options.limit_handling);
+    }
+    if (options.objective == "limits") chain.set_objective_weight(LIMIT_AVOIDANCE, options.objective_weight);
+    if (options.objective == "rest") chain.set_objective_weight(REST_POSE, options.objective_weight);
+    if (options.objective == "manipulability") chain.set_objective_weight(MANIPULABILITY, options.objective_weight);
+
+    if (options.scenario == "pose") {
+        return print_pose_result(options, run_pose(chain, options)) ? 0 : 1;
+    }
+
+    n_allocations = 0;
+    Result result;
+    if (options.scenario == "tree") {
+        result = run_tree(chain, options);
+    } else {
+        std::vector<vec4> targets = make_targets(options, vec4(chain.end_effector().translation_, 1.0f));
+        result = options.scenario == "batch" ? run_batch(chain, targets, options)
+                                             : run_trajectory(chain, targets, options);
+    }
+    result.jacobian_deviation = deviation;
+
+    return print_result(options, (unsigned int)chain.n_dofs(), result) ? 0 : 1;
+}
+
+
+//=============================================================================
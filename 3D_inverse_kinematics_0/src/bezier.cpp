@@ -1,14 +1,19 @@
 #include "bezier.h"
 #include <utility>
 #include <cmath>
+#include <algorithm>
 #include <array>
+#include <cassert>
 
 // Calculate a point one of the Bezier curve segments
 // @param bp_offset  index into bezier_control_points_ of the first of four
 //                   control points defining the Bezier segment we want to evaluate.
 // @param t          parametric distance along the curve at which to evaluate
 vec3 PiecewiseBezier::eval_bezier(int bp_offset, float t) const {
-    return bezier_control_points_[bp_offset];
+    const vec3* p = &bezier_control_points_[bp_offset];
+    // Bernstein polynomials in Horner form, no pow()
+    const float s = 1.0f - t;
+    return s * (s * (s * p[0] + (3.0f * t) * p[1]) + (3.0f * t * t) * p[2]) + (t * t * t) * p[3];
 }
 
 // Calculate a tangent at point at one of the Bezier curve segments
@@ -17,29 +22,107 @@ vec3 PiecewiseBezier::eval_bezier(int bp_offset, float t) const {
 //                   the tangent at
 // @param t          parametric distance along the curve at which to evaluate
 vec3 PiecewiseBezier::eval_bezier_tangent(int bp_offset, float t) const {
-    return vec3(1, 0, 0);
+    const vec3* p = &bezier_control_points_[bp_offset];
+    // derivative of the cubic, a quadratic Bezier curve of the control point differences
+    const float s = 1.0f - t;
+    return 3.0f * (s * s * (p[1] - p[0]) + (2.0f * s * t) * (p[2] - p[1]) + (t * t) * (p[3] - p[2]));
 }
 
+// The segment of a uniform cubic B-spline between control points b1 and b2 is the
+// cubic Bezier curve with control points
+//   (b0 + 4 b1 + b2) / 6,  (2 b1 + b2) / 3,  (b1 + 2 b2) / 3,  (b1 + 4 b2 + b3) / 6,
+// consecutive segments share their end points.
 std::vector<vec3> PiecewiseBezier::control_polygon_to_bezier_points(std::vector<vec3> const& cp) {
     std::vector<vec3> bezier_pts;
+    assert(cp.size() >= 4);
     size_t numSegments = cp.size() - 3;
     bezier_pts.resize(3 * numSegments + 1);
 
+    for (size_t i = 0; i < numSegments; i++) {
+        const vec3& b0 = cp[i];
+        const vec3& b1 = cp[i + 1];
+        const vec3& b2 = cp[i + 2];
+        const vec3& b3 = cp[i + 3];
+        if (i == 0) {
+            bezier_pts[0] = (1.0f / 6.0f) * (b0 + 4.0f * b1 + b2);
+        }
+        bezier_pts[3 * i + 1] = (1.0f / 3.0f) * (2.0f * b1 + b2);
+        bezier_pts[3 * i + 2] = (1.0f / 3.0f) * (b1 + 2.0f * b2);
+        bezier_pts[3 * i + 3] = (1.0f / 6.0f) * (b1 + 4.0f * b2 + b3);
+    }
+
     return bezier_pts;
 }
 
-vec3 PiecewiseBezier::eval_piecewise_bezier_curve(float t) const {
+// Splits t in [0, 1] into the index of a segment and the parameter within it
+static std::pair<int, float> segment_parameter(int num_segments, float t) {
+    const float x = std::min(1.0f, std::max(0.0f, t)) * num_segments;
+    const int segment = std::min((int)x, num_segments - 1);
+    return std::make_pair(segment, x - segment);
+}
 
-    return eval_bezier(0, t);
+vec3 PiecewiseBezier::eval_piecewise_bezier_curve(float t) const {
+    std::pair<int, float> sp = segment_parameter(num_segments(), t);
+    return eval_bezier(3 * sp.first, sp.second);
 }
 
 vec3 PiecewiseBezier::operator()(float t) const {
     return eval_piecewise_bezier_curve(t);
 }
 
+// Derivative with respect to the global parameter t, each segment covers
+// 1 / num_segments() of it
 vec3 PiecewiseBezier::tangent(float t) const {
+    std::pair<int, float> sp = segment_parameter(num_segments(), t);
+    return (float)num_segments() * eval_bezier_tangent(3 * sp.first, sp.second);
+}
+
+void PiecewiseBezier::evaluate_range(float t0, float t1, size_t n, vec3* positions, vec3* tangents) const {
+    const int num_segs = num_segments();
+    const double dt = n > 1 ? (double(t1) - t0) / (n - 1) : 0.0;
+    // step in the parameter of a segment
+    const double h = dt * num_segs;
+
+    // P(u) = a u^3 + b u^2 + c u + d and its derivative, with their forward
+    // differences at step h, kept in double since the errors of the running
+    // sums grow with the number of steps. The first point starts a segment and sets them
+    double p[3] = {}, dp1[3] = {}, dp2[3] = {}, dp3[3] = {};
+    double q[3] = {}, dq1[3] = {}, dq2[3] = {};
+    int segment = -1;
 
-    return eval_bezier_tangent(0, t);
+    for (size_t i = 0; i < n; i++) {
+        std::pair<int, float> sp = segment_parameter(num_segs, float(t0 + i * dt));
+        if (sp.first != segment) {
+            // entering a new segment, start the differences at its first point
+            segment = sp.first;
+            const double u = sp.second;
+            const vec3* b = &bezier_control_points_[3 * segment];
+            for (int k = 0; k < 3; k++) {
+                const double a3 = -b[0][k] + 3.0 * b[1][k] - 3.0 * b[2][k] + b[3][k];
+                const double a2 = 3.0 * (b[0][k] - 2.0 * b[1][k] + b[2][k]);
+                const double a1 = 3.0 * (b[1][k] - b[0][k]);
+                p[k]   = ((a3 * u + a2) * u + a1) * u + b[0][k];
+                dp1[k] = a3 * (3.0 * u * u * h + 3.0 * u * h * h + h * h * h) + a2 * (2.0 * u * h + h * h) + a1 * h;
+                dp2[k] = a3 * (6.0 * u * h * h + 6.0 * h * h * h) + 2.0 * a2 * h * h;
+                dp3[k] = 6.0 * a3 * h * h * h;
+                q[k]   = (3.0 * a3 * u + 2.0 * a2) * u + a1;
+                dq1[k] = 3.0 * a3 * (2.0 * u * h + h * h) + 2.0 * a2 * h;
+                dq2[k] = 6.0 * a3 * h * h;
+            }
+        }
+
+        positions[i] = vec3(float(p[0]), float(p[1]), float(p[2]));
+        if (tangents) {
+            tangents[i] = float(num_segs) * vec3(float(q[0]), float(q[1]), float(q[2]));
+        }
+        for (int k = 0; k < 3; k++) {
+            p[k] += dp1[k];
+            dp1[k] += dp2[k];
+            dp2[k] += dp3[k];
+            q[k] += dq1[k];
+            dq1[k] += dq2[k];
+        }
+    }
 }
 
 void PiecewiseBezier::set_control_polygon(const std::vector<vec3> &control_polygon, bool loop) {
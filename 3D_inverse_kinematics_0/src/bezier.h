@@ -19,6 +19,12 @@ public:
     vec3 operator()(float t) const;
     vec3 tangent(float t) const;
 
+    // Evaluate n points equally spaced in t from t0 to t1 (inclusive) into the
+    // caller's buffers, which must hold n values each. tangents may be null.
+    // Within a segment the points are advanced by forward differences, so a
+    // point costs a few additions instead of a Bernstein evaluation.
+    void evaluate_range(float t0, float t1, size_t n, vec3* positions, vec3* tangents) const;
+
     // Number of Bezier curve segments making up the spline curve.
     int num_segments() const {
         // There is a Bezier curve segment for each interior edge of the spline
@@ -18,6 +18,12 @@ struct Frame {
         if (m_useParallelTransport) {
             vec3 sinThetaAxis = cross(t, tnew);
             float cosTheta = dot(t, tnew);
+            if (1 + cosTheta < 1e-6f) {
+                // the tangent reversed, half a turn around up
+                t    = tnew;
+                left = -left;
+                return;
+            }
             t    = tnew;
             up   = (dot(sinThetaAxis, up  ) / (1 + cosTheta)) * sinThetaAxis + cross(sinThetaAxis, up  ) + cosTheta * up;
             left = (dot(sinThetaAxis, left) / (1 + cosTheta)) * sinThetaAxis + cross(sinThetaAxis, left) + cosTheta * left;
@@ -29,6 +35,16 @@ struct Frame {
         }
     }
 
+    // Align the frame with each of the n tangents in turn, e.g. those written by
+    // PiecewiseBezier::evaluate_range, and store the frame at every point as the
+    // rotation xyzToFrame() in frames, which must hold n matrices.
+    void alignAlong(const vec3 *tangents, size_t n, mat3 *frames) {
+        for (size_t i = 0; i < n; ++i) {
+            alignTo(tangents[i]);
+            frames[i] = xyzToFrame();
+        }
+    }
+
     // Initialize the OpenGL arrays/buffers with the arrow geometry for frame
     // visualization
     void initialize() {
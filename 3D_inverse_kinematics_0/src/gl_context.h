@@ -6,9 +6,9 @@
 #include "mesh/mesh.h"
 
 typedef struct {
-    Shader* phong_shader;
-    Shader* solid_color_shader;
-    Shader* color_shader;
+    std::shared_ptr<Shader> phong_shader;
+    std::shared_ptr<Shader> solid_color_shader;
+    std::shared_ptr<Shader> color_shader;
 
     Mesh* unit_sphere;
     Mesh* unit_cylinder;
@@ -8,6 +8,7 @@
 //=============================================================================
 
 #include "glmath.h"
+#include "simd.h"
 
 //=============================================================================
 
@@ -129,7 +130,7 @@ mat4::mat4(const float s)
 //-----------------------------------------------------------------------------
 
 
-vec3 mat4::base_x() {
+vec3 mat4::base_x() const {
     return vec3(data_[0 + 0*4], data_[1 + 0*4], data_[2 + 0*4]);
 }
 
@@ -137,7 +138,7 @@ vec3 mat4::base_x() {
 //-----------------------------------------------------------------------------
 
 
-vec3 mat4::base_y() {
+vec3 mat4::base_y() const {
     return vec3(data_[0 + 1*4], data_[1 + 1*4], data_[2 + 1*4]);
 }
 
@@ -145,7 +146,7 @@ vec3 mat4::base_y() {
 //-----------------------------------------------------------------------------
 
 
-vec3 mat4::base_z() {
+vec3 mat4::base_z() const {
     return vec3(data_[0 + 2*4], data_[1 + 2*4], data_[2 + 2*4]);
 }
 
@@ -155,18 +156,16 @@ vec3 mat4::base_z() {
 
 vec4 operator*(const mat4& m, const vec4& v0)
 {
-    vec4 v;
-
-    for (int i=0; i<4; ++i)
-    {
-        v[i] =0.0;
-        for (int j=0; j<4; ++j)
-        {
-            v[i] += m(i,j) * v0[j];
-        }
-    }
-
-    return v;
+    // sum of the columns weighted by the vector's components
+    const float* d = m.data();
+    simd4f v = simd4f_mul(simd4f_load(d), simd4f_splat(v0[0]));
+    v = simd4f_madd(simd4f_load(d + 4),  simd4f_splat(v0[1]), v);
+    v = simd4f_madd(simd4f_load(d + 8),  simd4f_splat(v0[2]), v);
+    v = simd4f_madd(simd4f_load(d + 12), simd4f_splat(v0[3]), v);
+
+    vec4 result;
+    simd4f_store(&result[0], v);
+    return result;
 }
 
 //-----------------------------------------------------------------------------
@@ -174,16 +173,23 @@ vec4 operator*(const mat4& m, const vec4& v0)
 
 mat4 operator*(const mat4& m0, const mat4& m1)
 {
-    mat4 m;
+    // column j of the product is m0 times column j of m1
+    const float* a = m0.data();
+    const float* b = m1.data();
+    simd4f a0 = simd4f_load(a);
+    simd4f a1 = simd4f_load(a + 4);
+    simd4f a2 = simd4f_load(a + 8);
+    simd4f a3 = simd4f_load(a + 12);
 
-    for (int i=0; i<4; ++i)
+    mat4 m;
+    for (int j=0; j<4; ++j)
     {
-        for (int j=0; j<4; ++j)
-        {
-            m(i,j) = 0.0f;
-            for (int k=0; k<4; ++k)
-                m(i,j) += m0(i,k) * m1(k,j);
-        }
+        const float* bj = b + 4*j;
+        simd4f c = simd4f_mul(a0, simd4f_splat(bj[0]));
+        c = simd4f_madd(a1, simd4f_splat(bj[1]), c);
+        c = simd4f_madd(a2, simd4f_splat(bj[2]), c);
+        c = simd4f_madd(a3, simd4f_splat(bj[3]), c);
+        simd4f_store(&m(0,j), c);
     }
 
     return m;
@@ -193,6 +199,27 @@ mat4 operator*(const mat4& m0, const mat4& m1)
 //-----------------------------------------------------------------------------
 
 
+mat4 transpose(const mat4& m)
+{
+    const float* d = m.data();
+    simd4f c0 = simd4f_load(d);
+    simd4f c1 = simd4f_load(d + 4);
+    simd4f c2 = simd4f_load(d + 8);
+    simd4f c3 = simd4f_load(d + 12);
+    simd4f_transpose(c0, c1, c2, c3);
+
+    mat4 mt;
+    simd4f_store(&mt(0,0), c0);
+    simd4f_store(&mt(0,1), c1);
+    simd4f_store(&mt(0,2), c2);
+    simd4f_store(&mt(0,3), c3);
+    return mt;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
 
 mat4 mat4::identity()
 {
@@ -352,7 +352,7 @@ public:
     const float* data() const { return &x; }
 
     // cast vec4 to vec3 by simply removing w-component
-    operator vec3() { return vec3(x,y,z); }
+    operator vec3() const { return vec3(x,y,z); }
 
     /// read/write the _i'th vector component (_i from 0 to 3)
     float& operator[](unsigned int _i)
@@ -602,11 +602,11 @@ public:
     const float* data() const { return data_; }
 
     /// get transformed basis vector x
-    vec3 base_x();
+    vec3 base_x() const;
     /// get transformed basis vector y
-    vec3 base_y();
+    vec3 base_y() const;
     /// get transformed basis vector z
-    vec3 base_z();
+    vec3 base_z() const;
 
     /// return identity matrix
     static mat4 identity();
@@ -640,6 +640,9 @@ mat4 operator*(const mat4& m0, const mat4& m1);
 /// return matrix-vector product m*v
 vec4 operator*(const mat4& m, const vec4& v0);
 
+/// return transposed matrix
+mat4 transpose(const mat4& m);
+
 /// print matrix to output stream
 std::ostream& operator<<(std::ostream& os, const mat4& m);
 
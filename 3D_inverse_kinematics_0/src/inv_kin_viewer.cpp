@@ -11,6 +11,7 @@
 #include <stdlib.h>     /* srand, rand */
 #include <time.h>       /* time */
 #include <array>
+#include <algorithm>
 
 
 //=============================================================================
@@ -29,32 +30,37 @@ Inv_kin_viewer::Inv_kin_viewer(const char* _title, int _width, int _height) :
 
     math_model_ = Kinematics();
 
-    math_model_.add_object(new Ball(origin_, mat4::identity(), 0.35f));
-    math_model_.add_object(new Bone(origin_, mat4::identity(), 0.15f, 2.0f));
-    math_model_.add_object(new Hinge(origin_, mat4::identity(), 0.3f));
-    math_model_.add_object(new Bone(origin_, mat4::identity(), 0.15f, 1.5f));
-    // math_model_.add_object(new Ball(origin_, mat4::identity(), 0.3f));
-    // math_model_.add_object(new Bone(origin_, mat4::identity(), 0.15f, 2.0f));
-    math_model_.add_object(new Axial(origin_, mat4::identity(), 0.25f));
-    // math_model_.add_object(new Bone(origin_, mat4::identity(), 0.15f, 1.0f));
+    math_model_.add_joint(Joint::ball());
+    math_model_.add_joint(Joint::bone(2.0f));
+    math_model_.add_joint(Joint::hinge());
+    math_model_.add_joint(Joint::bone(1.5f));
+    // math_model_.add_joint(Joint::ball());
+    // math_model_.add_joint(Joint::bone(2.0f));
+    math_model_.add_joint(Joint::axial());
+    // math_model_.add_joint(Joint::bone(1.0f));
 
+    // the elbow does not bend back through the upper arm
+    math_model_.set_limits(2, -150.0f, 150.0f);
+    math_model_.set_limit_handling(CLAMP_DOFS);
 
-    curr_end_effector = math_model_.update_body_positions();
+    // the two spare DOFs keep the arm away from the stretched out singular pose
+    math_model_.set_objective_weight(MANIPULABILITY, 0.05f);
+
+    body_view_.build(math_model_);
+
+    update_body_positions();
     std::cout << curr_end_effector << std::endl;
 
     n_points = 500;
     vec4 control_point1(-1.0f, 3.0f, 0.0f, 1.0f);
     vec4 control_point2(4.0f, 2.5f, 0.0f, 1.0f);
-    // bezier_curve = quadraticBezier(curr_end_effector, control_point1, target_.base_location_, n_points);
-    bezier_curve = cubicBezier(curr_end_effector, control_point1, control_point2, target_.base_location_, n_points);
+    path_.set_cubic((vec3)curr_end_effector, (vec3)control_point1, (vec3)control_point2, (vec3)target_.base_location_);
+    path_.sample(n_points, bezier_curve);
 
     line = fitLine(curr_end_effector, target_.base_location_, n_points);
-    bezier_iterator = 1;
 
-    for(int i = 0; i < n_points; i++) {
-        curve_visualization.push_back(new Object(bezier_curve[i], mat4::identity(), 0.05f, OBJECT, vec3(0.5f, 0.0f, 0.0f)));
-        line_visualization.push_back(new Object(line[i], mat4::identity(), 0.05f, OBJECT, vec3(0.0f, 0.5f, 0.0f)));        
-    }
+    path_markers_.add(bezier_curve, 0.05f, vec3(0.5f, 0.0f, 0.0f));
+    path_markers_.add(line, 0.05f, vec3(0.0f, 0.5f, 0.0f));
 
     
 
@@ -62,6 +68,18 @@ Inv_kin_viewer::Inv_kin_viewer(const char* _title, int _width, int _height) :
     timer_active_ = true;
     time_step_ = 1.0f;
 
+    // the path is solved ahead of the animation, accurately enough that the
+    // differences of neighbouring solutions are the motion and not solver noise
+    solve_options_.tolerance = 1e-4f;
+    solve_options_.max_iterations = 200;
+
+    // the same limits for every DOF, in degrees per second and per second^2
+    const std::vector<float> max_velocity(math_model_.n_dofs(), 90.0f);
+    const std::vector<float> max_acceleration(math_model_.n_dofs(), 360.0f);
+    motion_timing_.set_limits(Span<const float>(max_velocity.data(), max_velocity.size()),
+                              Span<const float>(max_acceleration.data(), max_acceleration.size()));
+    plan_motion();
+
     // rendering parameters
     greyscale_     = false;
     fovy_ = 45;
@@ -79,122 +97,93 @@ Inv_kin_viewer::Inv_kin_viewer(const char* _title, int _width, int _height) :
 
 //-----------------------------------------------------------------------------
 
-vec4 Inv_kin_viewer::calculate_next_target(vec4 target, vec4 effector)
-{
-
-    vec3 diff = (vec3)target - (vec3)effector;
-    diff = normalize(diff);
-    float t = 0.005f;
-    vec3 temp = (vec3)effector;
-    const vec3 next_target = temp + t*diff;
-    return vec4(next_target.x, next_target.y, next_target.z, 1.0f);
-
-}
-
-//-----------------------------------------------------------------------------
-
 std::vector<vec4> Inv_kin_viewer::fitLine(vec4 p0, vec4 p1, int t)
 {
-    std::vector<vec4> final_curve (t, vec4(0.0f, 0.0f, 0.0f, 1.0f));
-    final_curve[0] = p0;
-    final_curve[t-1] = p1;
-   
-    vec3 point(0.0f, 0.0f, 0.0f);
-    vec3 diff = (vec3)p1 - (vec3)p0;
-
-    for (int i = 0; i < t-1; i++) {
-        float step = (1.0f / (t+1)) * i;
-        
-        point = (vec3)p0 + step*diff;
-        final_curve[i] = vec4(point.x, point.y, point.z, 1.0f);
-    }
-    return final_curve;
+    Trajectory line;
+    line.set_line((vec3)p0, (vec3)p1);
+    return line.sample(t);
 }
 
 
 //-----------------------------------------------------------------------------
 
-std::vector<vec4> Inv_kin_viewer::quadraticBezier(vec4 p0, vec4 p1, vec4 p2, int t)
-{
-    std::vector<vec4> final_curve (t, vec4(0.0f, 0.0f, 0.0f, 1.0f));
-    final_curve[0] = p0;
-    final_curve[t-1] = p2;
-
-    vec4 point(0.0f, 0.0f, 0.0f, 1.0f);
-
-    for (int i = 1; i < t-1; i++) {
-        float step = (1.0f / (t+1)) * i;
-        point.x = pow(1-step, 2) * p0.x +
-                  (1-step) * 2 * step * p1.x +
-                  step * step * p2.x;
-
-        point.y = pow(1-step, 2) * p0.y +
-                  (1-step) * 2 * step * p1.y +
-                  step * step * p2.y;
-
-        point.z = pow(1-step, 2) * p0.z +
-                  (1-step) * 2 * step * p1.z +
-                  step * step * p2.z;
-        
-        final_curve[i] = point;
-        
-    }
-    return final_curve;
 
-}
+void Inv_kin_viewer::timer()
+{
+    if (timer_active_) {
+        universe_time_ += time_step_;
+        //std::cout << "Universe age [days]: " << universe_time_ << std::endl;
 
-//-----------------------------------------------------------------------------
+        // nothing to play back if the last plan failed
+        if (dof_path_.empty() || motion_time_ > motion_timing_.duration()) return;
+
+        // the schedule gives the distance along the path, the joint values between
+        // the two solved targets around it are interpolated
+        const float s = motion_timing_.position(motion_time_);
+        const size_t n = path_positions_.size();
+        const size_t above = std::upper_bound(path_positions_.begin(), path_positions_.end(), s) - path_positions_.begin();
+        const size_t i = std::min(std::max(above, (size_t)1), n - 1) - 1;
+        const float f = std::min(1.0f, std::max(0.0f, (s - path_positions_[i]) / (path_positions_[i + 1] - path_positions_[i])));
+        const size_t n_dofs = math_model_.n_dofs();
+        frame_dofs_.resize(n_dofs);
+        for (size_t j = 0; j < n_dofs; j++) {
+            frame_dofs_[j] = (1.0f - f) * dof_path_[i * n_dofs + j] + f * dof_path_[(i + 1) * n_dofs + j];
+        }
+        math_model_.set_dof_values(Span<const float>(frame_dofs_.data(), n_dofs));
+        update_body_positions();
 
-std::vector<vec4> Inv_kin_viewer::cubicBezier(vec4 p0, vec4 p1, vec4 p2, vec4 p3, int t)
-{
-    std::vector<vec4> final_curve (t, vec4(0.0f, 0.0f, 0.0f, 1.0f));
-    final_curve[0] = p0;
-    final_curve[t-1] = p3;
-
-    vec4 point(0.0f, 0.0f, 0.0f, 1.0f);
-
-    for (int i = 1; i < t-1; i++) {
-        float step = (1.0f / (t+1)) * i;
-        point.x = pow(1-step, 3) * p0.x +
-                  pow(1-step, 2) * 3 * step * p1.x +
-                  (1-step) * 3 * step * step * p2.x +
-                  step * step * step * p3.x;
-
-        point.y = pow(1-step, 3) * p0.y +
-                  pow(1-step, 2) * 3 * step * p1.y +
-                  (1-step) * 3 * step * step * p2.y +
-                  step * step * step * p3.y;
-
-        point.z = pow(1-step, 3) * p0.z +
-                  pow(1-step, 2) * 3 * step * p1.z +
-                  (1-step) * 3 * step * step * p2.z +
-                  step * step * step * p3.z;
-        
-        final_curve[i] = point;
-        
+        // one frame of 1/60 s
+        motion_time_ += time_step_ / 60.0f;
     }
-    return final_curve;
 }
 
 
-void Inv_kin_viewer::timer()
-{
-    if (timer_active_) {
-        universe_time_ += time_step_;
-        //std::cout << "Universe age [days]: " << universe_time_ << std::endl;
+//-----------------------------------------------------------------------------
 
-        curr_end_effector = math_model_.update_body_positions();
 
-        // calculate next target
-        //vec4 next_target = calculate_next_target(target_.base_location_, curr_end_effector);
+void Inv_kin_viewer::plan_motion()
+{
+    const Span<const float> state = math_model_.state();
+    const std::vector<float> start(state.begin(), state.end());
 
-        if(bezier_iterator > bezier_curve.size()-1) return;
+    path_positions_.clear();
+    dof_path_.clear();
+    std::vector<float> values = math_model_.dof_values();
+    int n_missed = 0;
+    for (int i = 0; i < n_points; i++) {
+        // every solve starts from the previous solution, the joint path is continuous
+        const Solve_outcome outcome = math_model_.solve(bezier_curve[i], solve_options_);
+        if (outcome.termination != CONVERGED) {
+            // a target out of reach is left out, the playback interpolates across it.
+            // The next solve starts again from the last solution on the path
+            n_missed++;
+            math_model_.set_dof_values(Span<const float>(values.data(), values.size()));
+            continue;
+        }
+        values = math_model_.dof_values();
+        path_positions_.push_back(path_.length() * i / (n_points - 1));
+        dof_path_.insert(dof_path_.end(), values.begin(), values.end());
+    }
 
-        vec4 next_target = bezier_curve[bezier_iterator++];
-        //vec4 next_target = line[bezier_iterator++];
+    math_model_.set_state(Span<const float>(start.data(), start.size()));
 
-        // make small end effector step towards target_location_
-        math_model_.step(next_target, time_step_);
+    if (n_missed > 0) {
+        std::cout << "Motion: " << n_missed << " of " << n_points << " targets not reached, left out\n";
+    }
+
+    motion_time_ = 0.0f;
+    if (path_positions_.size() < 2) {
+        std::cout << "Motion: too few targets reached to follow the path\n";
+        path_positions_.clear();
+        dof_path_.clear();
+    }
+    else if (motion_timing_.compute(path_positions_, dof_path_)) {
+        std::cout << "Motion: " << motion_timing_.duration() << " s\n";
+    }
+    else {
+        std::cout << "Motion: the path cannot be followed within the joint limits\n";
+        path_positions_.clear();
+        dof_path_.clear();
     }
 }
 
@@ -202,14 +191,8 @@ void Inv_kin_viewer::timer()
 //-----------------------------------------------------------------------------
 
 
-void Inv_kin_viewer::update_body_dofs(std::vector<std::vector<float>> next_state) {
-    if (!next_state.empty()) {
-        auto phi_it = next_state.begin();
-
-        for (Object* object: math_model_.model_) {
-            object->update_dof(*(phi_it++));
-        }
-    }
+void Inv_kin_viewer::update_body_positions() {
+    curr_end_effector = body_view_.update(math_model_);
 }
 
 
@@ -228,20 +211,25 @@ void Inv_kin_viewer::initialize()
 {
     unit_sphere_ = Sphere_Mesh(50);
     unit_cylinder_ = Cylinder_Mesh(50);
+    marker_sphere_ = Sphere_Mesh(8);
 
     // set initial state
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glEnable(GL_DEPTH_TEST);
 
     // setup shaders
-    color_shader_.load(SHADER_PATH "/color.vert", SHADER_PATH "/color.frag");
-    phong_shader_.load(SHADER_PATH "/phong.vert", SHADER_PATH "/phong.frag");
-    solid_color_shader_.load(SHADER_PATH "/solid_color.vert", SHADER_PATH "/solid_color.frag");
+    color_shader_ = shaders_.load(SHADER_PATH "/color.vert", SHADER_PATH "/color.frag");
+    phong_shader_ = shaders_.load(SHADER_PATH "/phong.vert", SHADER_PATH "/phong.frag");
+    solid_color_shader_ = shaders_.load(SHADER_PATH "/solid_color.vert", SHADER_PATH "/solid_color.frag");
+    marker_shader_ = shaders_.load(SHADER_PATH "/marker.vert", SHADER_PATH "/marker.frag");
+    phong_shader_->bind_uniform_block("Scene_uniforms", Scene_uniforms::binding);
+    marker_shader_->bind_uniform_block("Scene_uniforms", Scene_uniforms::binding);
+    scene_uniforms_.gl_setup();
 
     GL_Context ctx;
-    ctx.color_shader = &color_shader_;
-    ctx.solid_color_shader = &solid_color_shader_;
-    ctx.phong_shader = &phong_shader_;
+    ctx.color_shader = color_shader_;
+    ctx.solid_color_shader = solid_color_shader_;
+    ctx.phong_shader = phong_shader_;
     ctx.unit_sphere = dynamic_cast<Mesh*>(&unit_sphere_);
     ctx.unit_cylinder = dynamic_cast<Mesh*>(&unit_cylinder_);
     ctx.day   = new Texture();
@@ -261,13 +249,10 @@ void Inv_kin_viewer::initialize()
     viewer_.gl_setup(ctx);
     axes_origin_.gl_setup(ctx);
     target_.gl_setup(ctx);
-    math_model_.gl_setup(ctx);
+    body_view_.gl_setup(ctx);
 
     // set up gl context for the path visualization
-    for (int i = 0; i < n_points; i++) {
-        curve_visualization[i]->gl_setup(ctx);
-        line_visualization[i]->gl_setup(ctx);
-    }
+    path_markers_.gl_setup(&marker_sphere_, marker_shader_);
 }
 
 
@@ -321,21 +306,23 @@ void Inv_kin_viewer::draw_scene(mat4& _projection, mat4& _view)
     // convert light into camera coordinates
     vec4 light = _view * light_.base_location_;
 
+    // one upload for all shaders that use the Scene_uniforms block
+    scene_uniforms_.update(_projection, _view, light, greyscale_);
+
     static float sun_animation_time = 0;
     if (timer_active_) sun_animation_time += 0.01f;
 
-    light_.draw(_projection, _view, light_, greyscale_);
-  //  viewer_.draw(_projection, _view, light_, greyscale_);
-    //axes_origin_.draw(_projection, _view);
-    target_.draw(_projection, _view, light_, greyscale_);
+    render_queue_.begin(_projection, _view);
+    light_.submit(render_queue_);
+  //  viewer_.submit(render_queue_);
+    //axes_origin_.submit(render_queue_);
+    target_.submit(render_queue_);
 
-    draw_objects(_projection, _view);
+    draw_objects();
+    render_queue_.flush();
 
     /// draw the path visualization
-    for (int i = 0; i < n_points; i++) {
-        curve_visualization[i]->draw(_projection, _view, light_, greyscale_);
-        line_visualization[i]->draw(_projection, _view, light_, greyscale_);
-    }
+    path_markers_.draw();
 
     glDisable(GL_BLEND);
 
@@ -347,11 +334,9 @@ void Inv_kin_viewer::draw_scene(mat4& _projection, mat4& _view)
 //-----------------------------------------------------------------------------
 
 
-void Inv_kin_viewer::draw_objects(mat4& _projection, mat4& _view)
+void Inv_kin_viewer::draw_objects()
 {
-    for (Object* object: math_model_.model_) {
-        object->draw(_projection, _view, light_, greyscale_);
-    }
+    body_view_.submit(render_queue_);
 }
 
 
@@ -461,35 +446,33 @@ void Inv_kin_viewer::keyboard(int key, int scancode, int action, int mods)
             case GLFW_KEY_R:
             {
                 // math_model_.reset();
-                bezier_iterator = 1;
                 target_.base_location_ = vec4(-2.0f, 1.0f, 0.0f, 1.0f);
 
                 vec4 control_point1(-3.0f, 3.0f, 0.5f, 1.0f);
                 vec4 control_point2(5.0f, 2.5f, 0.7f, 1.0f);
 
-                bezier_curve = cubicBezier(curr_end_effector, control_point1, control_point2, target_.base_location_, n_points);
-                // bezier_curve = quadraticBezier(curr_end_effector, control_point1, target_.base_location_, n_points);
+                path_.set_cubic((vec3)curr_end_effector, (vec3)control_point1, (vec3)control_point2, (vec3)target_.base_location_);
+                path_.sample(n_points, bezier_curve);
+                plan_motion();
                 line = fitLine(curr_end_effector, target_.base_location_, n_points);
 
-                GL_Context ctx;
-                ctx.color_shader = &color_shader_;
-                ctx.solid_color_shader = &solid_color_shader_;
-                ctx.phong_shader = &phong_shader_;
-                ctx.unit_sphere = dynamic_cast<Mesh*>(&unit_sphere_);
-                ctx.unit_cylinder = dynamic_cast<Mesh*>(&unit_cylinder_);
-
-                for(int i = 0; i < n_points; i++) {
-                    curve_visualization[i] = (new Object(bezier_curve[i], mat4::identity(), 0.05f, OBJECT, vec3(0.5f, 0.0f, 0.0f)));
-                    line_visualization[i] =(new Object(line[i], mat4::identity(), 0.05f, OBJECT, vec3(0.0f, 0.5f, 0.0f)));   
-
-                    curve_visualization[i]->gl_setup(ctx);
-                    line_visualization[i]->gl_setup(ctx);     
-                }
+                path_markers_.clear();
+                path_markers_.add(bezier_curve, 0.05f, vec3(0.5f, 0.0f, 0.0f));
+                path_markers_.add(line, 0.05f, vec3(0.0f, 0.5f, 0.0f));
 
                 // timer_active_ = false;
                 break;
             }
 
+            case GLFW_KEY_I:
+            {
+                const Render_stats& stats = render_queue_.stats();
+                std::cout << "Render queue: " << stats.items << " items, " << stats.draw_calls << " draw calls, "
+                          << stats.program_binds << " program, " << stats.texture_binds << " texture and "
+                          << stats.mesh_binds << " mesh binds\n";
+                break;
+            }
+
             case GLFW_KEY_SPACE:
             {
                 timer_active_ = !timer_active_;
@@ -24,9 +24,15 @@
 #include "object/viewer.h"
 #include "object/axes.h"
 #include "object/ball.h"
+#include "object/kinematics_view.h"
 #include "path.h"
 #include "frame.h"
 #include "bezier.h"
+#include "trajectory.h"
+#include "time_parameterization.h"
+#include "marker_renderer.h"
+#include "scene_uniforms.h"
+#include "render_queue.h"
 
 
 //=============================================================================
@@ -64,30 +70,28 @@ protected:
     /// \param _view the view matrix for the scene
     void draw_scene(mat4& _projection, mat4& _view);
 
-    void draw_objects(mat4& _projection, mat4& _view);
+    /// adds the bodies of the chain to render_queue_
+    void draw_objects();
 
     /// update function on every timer event (controls the animation)
     virtual void timer();
 
-    /// Writes angles in the objects
-    void update_body_dofs(std::vector<std::vector<float>> next_state);
-
     /// update the body positions (called by the timer).
     void update_body_positions();
 
-    vec4 calculate_next_target(vec4 target, vec4 effector);
-
-    std::vector<vec4> quadraticBezier(vec4 p0, vec4 p1, vec4 p2, int t);
+    /// solves the IK at every target of bezier_curve and schedules the joint path
+    /// under the joint limits, the timer then plays it back from the start. Targets
+    /// the solver does not converge to are reported and left out of the path
+    void plan_motion();
 
+    /// t targets equally spaced from p0 to p2
     std::vector<vec4> fitLine(vec4 p0, vec4 p2, int t);
 
-    std::vector<vec4> cubicBezier(vec4 p0, vec4 p1, vec4 p2, vec4 p3, int t);
-
 
 private:
 
-    std::vector<Object*> curve_visualization;
-    std::vector<Object*> line_visualization;
+    /// the targets along bezier_curve and line, drawn with one instanced draw call
+    Marker_renderer path_markers_;
 
     /// origin of coordinate system
     vec4 origin_ = vec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -98,12 +102,38 @@ private:
 
     Kinematics math_model_;
 
+    /// tolerance and budget of the IK solve towards every target of the planned path
+    Solve_options solve_options_;
+
+    /// the curve the end effector follows, bezier_curve holds n_points targets along it
+    Trajectory path_;
+
+    /// DOF values of math_model_ solved at the targets of bezier_curve the IK converged to,
+    /// and the distance along path_ of each of those targets. Both empty if planning failed
+    std::vector<float> dof_path_;
+    std::vector<float> path_positions_;
+
+    /// DOF values of the current frame, interpolated from dof_path_ by the timer
+    std::vector<float> frame_dofs_;
+
+    /// time optimal schedule of dof_path_ under the joint velocity and acceleration limits
+    Time_parameterization motion_timing_;
+
+    /// seconds into the schedule, advanced by time_step_ / 60 per frame
+    float motion_time_;
+
+    /// drawable objects mirroring the joints of math_model_
+    Kinematics_view body_view_;
+
     /// sphere object
     Sphere_Mesh unit_sphere_;
 
     /// cylinder object
     Cylinder_Mesh unit_cylinder_;
 
+    /// coarse sphere of the path markers, its vertex array holds their instance attributes
+    Sphere_Mesh marker_sphere_;
+
     /// the light object
     Light light_;
 
@@ -113,13 +143,24 @@ private:
     /// the object the viewer is looking at
     Axes axes_origin_;
 
+    /// compiles every shader program once, the objects share the handles
+    Shader_registry shaders_;
+
     /// default color shader (renders only texture)
-    Shader   color_shader_;
+    std::shared_ptr<Shader> color_shader_;
     /// phong shader (renders texture and basic illumination)
-    Shader   phong_shader_;
+    std::shared_ptr<Shader> phong_shader_;
 
     /// simple shader for visualizing curves (just using solid color).
-    Shader   solid_color_shader_;
+    std::shared_ptr<Shader> solid_color_shader_;
+    /// solid color shader with per instance position, scale and color
+    std::shared_ptr<Shader> marker_shader_;
+
+    /// projection, view, light and greyscale mode, uploaded once per frame
+    Scene_uniforms scene_uniforms_;
+
+    /// draw items of the frame, submitted sorted by program, texture and mesh
+    Render_queue render_queue_;
 
     /// interval for the animation timer
     bool  timer_active_;
@@ -155,9 +196,6 @@ private:
     std::vector<vec4> bezier_curve;
     std::vector<vec4> line;
 
-    /// iterate over the bezier curve
-    int bezier_iterator;
-
     /// number of points on the bezier curve
     int n_points;
 
@@ -0,0 +1,38 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef AXIAL_JOINT_H
+#define AXIAL_JOINT_H
+//=============================================================================
+
+#include "glmath.h"
+#include "rigid_transform.h"
+#include "span.h"
+
+//=============================================================================
+
+/// rotation around the z axis of its base, one angle in degrees
+class Axial_joint
+{
+public:
+    static const size_t arity = 1;
+    static const size_t state_size = arity;
+
+public:
+    Rigid_transform forward(const Rigid_transform& _prev_frame, Span<const float> _state) const
+    {
+        return _prev_frame.rotated_z(_state[0]);
+    }
+
+    void dof_axes(const Rigid_transform& _prev_frame, Span<const float>, vec3* _axes) const
+    {
+        _axes[0] = _prev_frame.base_z();
+    }
+};
+
+
+//=============================================================================
+#endif // AXIAL_JOINT_H
+//=============================================================================
@@ -0,0 +1,105 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef BALL_JOINT_H
+#define BALL_JOINT_H
+//=============================================================================
+
+#include "glmath.h"
+#include "quaternion.h"
+#include "rigid_transform.h"
+#include "span.h"
+
+//=============================================================================
+
+/// free rotation of its base, stored as a unit quaternion (w, x, y, z) relative to the base.
+/// The three DOFs are rotations in degrees around the x, y and z axes of the base, which do
+/// not move with the joint, so there is no gimbal lock and no DOF carries another
+class Ball_joint
+{
+public:
+    static const size_t arity = 3;
+    static const size_t state_size = 4;
+
+public:
+    Rigid_transform forward(const Rigid_transform& _prev_frame, Span<const float> _state) const
+    {
+        return _prev_frame.rotated(Quaternion::load(_state.data()).to_rotation());
+    }
+
+    void dof_axes(const Rigid_transform& _prev_frame, Span<const float>, vec3* _axes) const
+    {
+        _axes[0] = _prev_frame.base_x();
+        _axes[1] = _prev_frame.base_y();
+        _axes[2] = _prev_frame.base_z();
+    }
+
+    /// the identity rotation
+    void rest_state(Span<float> _state) const
+    {
+        Quaternion().store(_state.data());
+    }
+
+    /// turns _state by the rotation vector _delta in degrees around the base axes, into _result
+    void integrate(Span<const float> _state, const float* _delta, Span<float> _result) const
+    {
+        const vec3 rotation(deg2rad(_delta[0]), deg2rad(_delta[1]), deg2rad(_delta[2]));
+        const Quaternion q = Quaternion::from_rotation_vector(rotation) * Quaternion::load(_state.data());
+        q.normalized().store(_result.data());
+    }
+
+    /// the rotation vector of _state in degrees, the coordinates the limits and the rest pose refer to
+    void coordinates(Span<const float> _state, float* _values) const
+    {
+        const vec3 rotation = Quaternion::load(_state.data()).log();
+        for (int i = 0; i < 3; i++) {
+            _values[i] = rad2deg(rotation[i]);
+        }
+    }
+
+    void set_coordinates(const float* _values, Span<float> _state) const
+    {
+        const vec3 rotation(deg2rad(_values[0]), deg2rad(_values[1]), deg2rad(_values[2]));
+        Quaternion::from_rotation_vector(rotation).store(_state.data());
+    }
+
+    /// turns the z axis after the joint onto the world direction _direction. If _side is
+    /// not zero the x axis after the joint is turned towards it, otherwise the joint takes
+    /// the shortest rotation from its current z axis
+    void aim(const Rigid_transform& _prev_frame, const vec3& _direction, const vec3& _side, Span<float> _state) const
+    {
+        if (norm(_direction) == 0.0f) {
+            return;
+        }
+
+        const Rigid_transform to_base = inverse(_prev_frame);
+        const vec3 z = normalize(to_base.apply_vector(_direction));
+        vec3 x = to_base.apply_vector(_side);
+        x -= dot(x, z) * z;
+
+        Quaternion q;
+        if (norm(x) < 1e-6f) {
+            const Quaternion current = Quaternion::load(_state.data());
+            q = Quaternion::between(current.to_rotation() * vec3(0.0f, 0.0f, 1.0f), z) * current;
+        } else {
+            // the rotation with columns x, z cross x, z relative to the base
+            x = normalize(x);
+            const vec3 y = cross(z, x);
+            mat3 r;
+            for (int i = 0; i < 3; i++) {
+                r(i,0) = x[i];
+                r(i,1) = y[i];
+                r(i,2) = z[i];
+            }
+            q = Quaternion::from_rotation(r);
+        }
+        q.normalized().store(_state.data());
+    }
+};
+
+
+//=============================================================================
+#endif // BALL_JOINT_H
+//=============================================================================
@@ -0,0 +1,43 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef BONE_JOINT_H
+#define BONE_JOINT_H
+//=============================================================================
+
+#include "glmath.h"
+#include "rigid_transform.h"
+#include "span.h"
+
+//=============================================================================
+
+/// rigid segment along the z axis of its base, no DOFs
+class Bone_joint
+{
+public:
+    static const size_t arity = 0;
+    static const size_t state_size = arity;
+
+    /// length of the bone
+    float length_;
+
+public:
+    Bone_joint(const float _length = 1.0f) :
+        length_(_length)
+    {}
+
+    Rigid_transform forward(const Rigid_transform& _prev_frame, Span<const float>) const
+    {
+        return Rigid_transform(_prev_frame.rotation_, _prev_frame.translation_ + length_ * _prev_frame.base_z());
+    }
+
+    void dof_axes(const Rigid_transform&, Span<const float>, vec3*) const
+    {}
+};
+
+
+//=============================================================================
+#endif // BONE_JOINT_H
+//=============================================================================
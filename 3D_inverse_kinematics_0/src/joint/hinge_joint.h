@@ -0,0 +1,49 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef HINGE_JOINT_H
+#define HINGE_JOINT_H
+//=============================================================================
+
+#include "glmath.h"
+#include "rigid_transform.h"
+#include "span.h"
+
+//=============================================================================
+
+/// rotation around the x axis of its base, one angle in degrees
+class Hinge_joint
+{
+public:
+    static const size_t arity = 1;
+    static const size_t state_size = arity;
+
+public:
+    Rigid_transform forward(const Rigid_transform& _prev_frame, Span<const float> _state) const
+    {
+        return _prev_frame.rotated_x(_state[0]);
+    }
+
+    void dof_axes(const Rigid_transform& _prev_frame, Span<const float>, vec3* _axes) const
+    {
+        _axes[0] = _prev_frame.base_x();
+    }
+
+    /// turns the z axis after the joint towards the world direction _direction,
+    /// as far as the rotation around x allows
+    void aim(const Rigid_transform& _prev_frame, const vec3& _direction, const vec3&, Span<float> _state) const
+    {
+        // rotate_x(a) takes z to (0, -sin a, cos a)
+        const vec3 d = inverse(_prev_frame).apply_vector(_direction);
+        if (d[1] != 0.0f || d[2] != 0.0f) {
+            _state[0] = rad2deg(atan2f(-d[1], d[2]));
+        }
+    }
+};
+
+
+//=============================================================================
+#endif // HINGE_JOINT_H
+//=============================================================================
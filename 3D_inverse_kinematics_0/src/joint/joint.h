@@ -0,0 +1,168 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef JOINT_H
+#define JOINT_H
+//=============================================================================
+
+#include <algorithm>
+#include <cassert>
+#include "glmath.h"
+#include "rigid_transform.h"
+#include "span.h"
+#include "bone_joint.h"
+#include "hinge_joint.h"
+#include "axial_joint.h"
+#include "ball_joint.h"
+
+//=============================================================================
+
+enum joint_type_t {BONE_JOINT, HINGE_JOINT, AXIAL_JOINT, BALL_JOINT};
+
+/// one node of a kinematic chain, either a rigid bone or a rotational joint.
+/// Joints carry only their geometry, their state lives in the flat state vector
+/// of Kinematics and the drawing is done by the render objects in object/.
+/// Kept small and free of virtual calls so a chain is one contiguous array,
+/// the math of every type is in Bone_joint, Hinge_joint, Axial_joint and
+/// Ball_joint, which Static_chain uses directly.
+class Joint
+{
+public:
+    /// the joint type
+    joint_type_t type_;
+
+    /// length of a bone along its z axis, 0 for rotational joints
+    float length_;
+
+public:
+    Joint(const joint_type_t _type, const float _length = 0.0f) :
+        type_(_type),
+        length_(_length)
+    {}
+
+    /// rigid segment of length _length along the z axis
+    static Joint bone(const float _length) { return Joint(BONE_JOINT, _length); }
+
+    /// rotation around the x axis, 1 DOF
+    static Joint hinge() { return Joint(HINGE_JOINT); }
+
+    /// rotation around the z axis, 1 DOF
+    static Joint axial() { return Joint(AXIAL_JOINT); }
+
+    /// free rotation stored as a quaternion, 3 DOFs around the x, y and z axes of its base
+    static Joint ball() { return Joint(BALL_JOINT); }
+
+    /// the largest arity of any joint type
+    static const size_t max_arity = Ball_joint::arity;
+
+    /// number of DOFs of the joint, all angles are in degrees
+    size_t arity() const
+    {
+        switch (type_) {
+            case HINGE_JOINT: return Hinge_joint::arity;
+            case AXIAL_JOINT: return Axial_joint::arity;
+            case BALL_JOINT:  return Ball_joint::arity;
+            case BONE_JOINT:
+            default:          return Bone_joint::arity;
+        }
+    }
+
+    /// number of floats of the joint's state: its angles, or the quaternion of a ball
+    size_t state_size() const
+    {
+        return type_ == BALL_JOINT ? Ball_joint::state_size : arity();
+    }
+
+    /// writes the state of the straight pose into _state
+    void rest_state(Span<float> _state) const
+    {
+        if (type_ == BALL_JOINT) {
+            Ball_joint().rest_state(_state);
+        } else {
+            std::fill(_state.begin(), _state.end(), 0.0f);
+        }
+    }
+
+    /// moves _state by _delta, one change in degrees per DOF, and writes the result into
+    /// _result, which may be _state itself. Angles are added, a ball is turned around its base axes
+    void integrate(Span<const float> _state, const float* _delta, Span<float> _result) const
+    {
+        if (type_ == BALL_JOINT) {
+            Ball_joint().integrate(_state, _delta, _result);
+            return;
+        }
+        for (size_t k = 0; k < _state.size(); k++) {
+            _result[k] = _state[k] + _delta[k];
+        }
+    }
+
+    /// writes one value in degrees per DOF of _state into _values, the coordinates limits and
+    /// rest poses refer to: the angles themselves, for a ball the rotation vector
+    void coordinates(Span<const float> _state, float* _values) const
+    {
+        if (type_ == BALL_JOINT) {
+            Ball_joint().coordinates(_state, _values);
+        } else {
+            std::copy(_state.begin(), _state.end(), _values);
+        }
+    }
+
+    /// the inverse of coordinates()
+    void set_coordinates(const float* _values, Span<float> _state) const
+    {
+        if (type_ == BALL_JOINT) {
+            Ball_joint().set_coordinates(_values, _state);
+        } else {
+            std::copy(_values, _values + _state.size(), _state.begin());
+        }
+    }
+
+    /// frame at the end of the joint, given the frame at its base
+    Rigid_transform forward(const Rigid_transform& _prev_frame, Span<const float> _state) const
+    {
+        assert(_state.size() == state_size());
+
+        switch (type_) {
+            case HINGE_JOINT: return Hinge_joint().forward(_prev_frame, _state);
+            case AXIAL_JOINT: return Axial_joint().forward(_prev_frame, _state);
+            case BALL_JOINT:  return Ball_joint().forward(_prev_frame, _state);
+            case BONE_JOINT:
+            default:          return Bone_joint(length_).forward(_prev_frame, _state);
+        }
+    }
+
+    /// writes the world space rotation axis of every DOF into _axes,
+    /// given the frame at the base of the joint. All axes pass through the base.
+    void dof_axes(const Rigid_transform& _prev_frame, Span<const float> _state, vec3* _axes) const
+    {
+        switch (type_) {
+            case HINGE_JOINT: Hinge_joint().dof_axes(_prev_frame, _state, _axes); break;
+            case AXIAL_JOINT: Axial_joint().dof_axes(_prev_frame, _state, _axes); break;
+            case BALL_JOINT:  Ball_joint().dof_axes(_prev_frame, _state, _axes); break;
+            case BONE_JOINT:
+            default:          break;
+        }
+    }
+
+    /// sets _state so the z axis after the joint, the direction of a following bone, points
+    /// as close to the world direction _direction as the joint allows. A ball also turns
+    /// its x axis towards _side unless that is zero. Bones and axial joints cannot turn
+    /// the z axis and leave _state alone
+    void aim(const Rigid_transform& _prev_frame, const vec3& _direction, const vec3& _side, Span<float> _state) const
+    {
+        switch (type_) {
+            case HINGE_JOINT: Hinge_joint().aim(_prev_frame, _direction, _side, _state); break;
+            case BALL_JOINT:  Ball_joint().aim(_prev_frame, _direction, _side, _state); break;
+            case AXIAL_JOINT:
+            case BONE_JOINT:
+            default:          break;
+        }
+    }
+};
+
+
+//=============================================================================
+#endif // JOINT_H
+//=============================================================================
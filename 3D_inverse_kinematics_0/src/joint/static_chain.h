@@ -0,0 +1,155 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef STATIC_CHAIN_H
+#define STATIC_CHAIN_H
+//=============================================================================
+
+#include <array>
+#include "glmath.h"
+#include "rigid_transform.h"
+#include "span.h"
+#include "bone_joint.h"
+#include "hinge_joint.h"
+#include "axial_joint.h"
+#include "ball_joint.h"
+
+//=============================================================================
+
+/// the joints from one position of a Static_chain to its end, every link
+/// holds one joint and the rest of the chain, so the calls are resolved and
+/// inlined at compile time
+template<typename... Joints>
+class Static_chain_link;
+
+template<>
+class Static_chain_link<>
+{
+public:
+    static const size_t n_dofs = 0;
+    static const size_t state_size = 0;
+
+    Rigid_transform forward(const Rigid_transform& _frame, const float*) const
+    {
+        return _frame;
+    }
+
+    Rigid_transform dof_axes(const Rigid_transform& _frame, const float*, vec3*, vec3*) const
+    {
+        return _frame;
+    }
+};
+
+template<typename First, typename... Rest>
+class Static_chain_link<First, Rest...>
+{
+public:
+    static const size_t n_dofs = First::arity + Static_chain_link<Rest...>::n_dofs;
+    static const size_t state_size = First::state_size + Static_chain_link<Rest...>::state_size;
+
+private:
+    First joint_;
+    Static_chain_link<Rest...> rest_;
+
+public:
+    Static_chain_link() {}
+
+    Static_chain_link(const First& _joint, const Rest&... _rest) :
+        joint_(_joint),
+        rest_(_rest...)
+    {}
+
+    /// frame at the end of the chain
+    Rigid_transform forward(const Rigid_transform& _frame, const float* _state) const
+    {
+        Span<const float> state(_state, First::state_size);
+        return rest_.forward(joint_.forward(_frame, state), _state + First::state_size);
+    }
+
+    /// collects the rotation axis and pivot of every DOF, returns the end of the chain
+    Rigid_transform dof_axes(const Rigid_transform& _frame, const float* _state, vec3* _axes, vec3* _pivots) const
+    {
+        Span<const float> state(_state, First::state_size);
+        joint_.dof_axes(_frame, state, _axes);
+        for (size_t j = 0; j < First::arity; j++) {
+            _pivots[j] = _frame.translation_;
+        }
+        return rest_.dof_axes(joint_.forward(_frame, state),
+                              _state + First::state_size, _axes + First::arity, _pivots + First::arity);
+    }
+};
+
+
+//=============================================================================
+
+
+/// kinematic chain whose layout is fixed at compile time, e.g.
+/// Static_chain<Ball_joint, Bone_joint, Hinge_joint, Bone_joint, Axial_joint>.
+/// Forward kinematics and the analytic Jacobian are the same as in Kinematics,
+/// but without the dispatch on the joint type and without heap memory.
+/// The state is a flat array of state_size floats, laid out like the state of
+/// a Kinematics with the same joints, and the Jacobian has n_dofs columns.
+template<typename... Joints>
+class Static_chain
+{
+public:
+    static const size_t n_dofs = Static_chain_link<Joints...>::n_dofs;
+    static const size_t state_size = Static_chain_link<Joints...>::state_size;
+
+private:
+    Static_chain_link<Joints...> joints_;
+
+    /// frame at the root of the chain, the same as in Kinematics
+    Rigid_transform root_;
+
+public:
+    /// chain with default constructed joints
+    Static_chain() :
+        root_(Rigid_transform::rotate_x(-90.0f))
+    {}
+
+    /// chain with the given joints, e.g. to set the bone lengths
+    Static_chain(const Joints&... _joints) :
+        joints_(_joints...),
+        root_(Rigid_transform::rotate_x(-90.0f))
+    {}
+
+    /// frame of the end effector for the state _state
+    Rigid_transform forward(const float* _state) const
+    {
+        return joints_.forward(root_, _state);
+    }
+
+    /// Jacobian of the end effector w.r.t. the DOFs, column-major with _rows
+    /// rows (3 for the location, 6 with the angular velocity) and n_dofs columns,
+    /// so it can be wrapped by arma::mat(_J, _rows, n_dofs, false)
+    void jacobian(const float* _state, unsigned int _rows, float* _J) const
+    {
+        std::array<vec3, n_dofs> axes;
+        std::array<vec3, n_dofs> pivots;
+        const vec3 end_effector = joints_.dof_axes(root_, _state, axes.data(), pivots.data()).translation_;
+
+        // a rotation of d_phi degrees around axis a through p moves the end effector e by
+        // a x (e - p) * d_phi in radians, and turns it by a * d_phi in radians
+        const float per_degree = deg2rad(1.0f);
+        for (size_t i = 0; i < n_dofs; i++) {
+            float* column = _J + i * _rows;
+            vec3 de_dphi = per_degree * cross(axes[i], end_effector - pivots[i]);
+            for (int j = 0; j < 3; j++) {
+                column[j] = de_dphi[j];
+            }
+            if (_rows == 6) {
+                for (int j = 0; j < 3; j++) {
+                    column[3 + j] = per_degree * axes[i][j];
+                }
+            }
+        }
+    }
+};
+
+
+//=============================================================================
+#endif // STATIC_CHAIN_H
+//=============================================================================
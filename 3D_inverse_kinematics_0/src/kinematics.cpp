@@ -5,185 +5,1137 @@
 //=============================================================================
 
 #include <algorithm>
+#include <chrono>
+#include <limits>
 #include <vector>
 
 #include "kinematics.h"
-#include "object/object.h"
-#include "object/bone.h"
-#include "object/hinge.h"
-#include "object/axial.h"
 #include "math_util.h"
 
 
-void Kinematics::add_object(Object* obj) {
-    model_.push_back(obj);
+size_t Kinematics::add_joint(const Joint& _joint) {
+    return add_joint(_joint, (int)joints_.size() - 1);
+}
 
-    switch(obj->object_type_) {
-        case BONE:
-            state_.push_back(std::vector<float>());
-            break;
-        case AXIAL:
-        case HINGE:
-            state_.push_back(std::vector<float>(1, 0.0f));
-            n_dofs_++;
-            break;
-        case BALL:
-            state_.push_back(std::vector<float>(3, 0.0f));
-            n_dofs_ += 3;
-            break;
-        default:
-            break;
-    }
+
+size_t Kinematics::add_joint(const Joint& _joint, int _parent) {
+    // parents come first, so one pass in index order visits every joint after its parent
+    assert(_parent < (int)joints_.size());
+    joints_.push_back(_joint);
+    parents_.push_back(_parent);
+    end_frames_.resize(joints_.size());
+    dirty_.resize(joints_.size());
+    frames_valid_ = false;
+    on_path_.resize(joints_.size());
+
+    Dof_range range = {n_dofs_, _joint.arity(), state_size_, _joint.state_size()};
+    dof_ranges_.push_back(range);
+    n_dofs_ += range.arity;
+    state_size_ += range.state_size;
+    state_.resize(state_size_);
+    _joint.rest_state(Span<float>(state_.data() + range.state_offset, range.state_size));
+    scratch_state_.resize(state_size_);
+    swept_state_.resize(state_size_);
+    dof_values_.resize(n_dofs_);
+    dof_perturbations_.resize(n_dofs_);
 
     delta_phi_last_ = arma::vec(n_dofs_);
-    n_small_updates_ = 0u;
+    forget_history();
+
+    dof_axes_.resize(n_dofs_);
+    dof_pivots_.resize(n_dofs_);
+
+    dof_joints_.resize(n_dofs_, joints_.size() - 1);
+    rest_pose_.resize(n_dofs_, 0.0f);
+    null_motion_ = arma::vec(n_dofs_);
+    position_columns_.resize(n_dofs_);
+    manipulability_b_.resize(n_dofs_);
+
+    lower_limits_.resize(n_dofs_, -std::numeric_limits<float>::infinity());
+    upper_limits_.resize(n_dofs_, std::numeric_limits<float>::infinity());
+    clamped_.resize(n_dofs_);
+    clamped_step_ = arma::vec(n_dofs_);
+
+    // the heuristic passes fill these with at most one entry per joint, so they keep
+    // their capacity from the first step of either solver on
+    path_joints_.reserve(joints_.size());
+    fabrik_points_.reserve(joints_.size() + 1);
+    fabrik_lengths_.reserve(joints_.size());
+    // without end effectors the last joint is the one, add_end_effector() reserves for more
+    last_target_locations_.reserve(1);
+
+    return joints_.size() - 1;
+}
+
+
+size_t Kinematics::add_end_effector(size_t _joint) {
+    assert(_joint < joints_.size());
+    effectors_.push_back(_joint);
+    has_last_step_ = false;
+    last_target_locations_.reserve(effectors_.size());
+    return effectors_.size() - 1;
+}
+
+
+void Kinematics::set_limits(size_t _i, float _lower, float _upper) {
+    const Dof_range& range = dof_ranges_[_i];
+    for (size_t j = 0; j < range.arity; j++) {
+        lower_limits_[range.offset + j] = _lower;
+        upper_limits_[range.offset + j] = _upper;
+    }
+    has_limits_ = true;
 }
 
 
-void Kinematics::gl_setup(GL_Context& ctx) {
-    for (Object* object: model_) {
-        object->gl_setup(ctx);
+void Kinematics::set_limits(size_t _i, Span<const float> _lower, Span<const float> _upper) {
+    const Dof_range& range = dof_ranges_[_i];
+    assert(_lower.size() == range.arity && _upper.size() == range.arity);
+    for (size_t j = 0; j < range.arity; j++) {
+        assert(_lower[j] <= _upper[j]);
+        lower_limits_[range.offset + j] = _lower[j];
+        upper_limits_[range.offset + j] = _upper[j];
     }
+    has_limits_ = true;
 }
 
 
-std::vector<std::vector<float>> Kinematics::copy_state() {
-    std::vector<std::vector<float>> new_state;
-    for (auto phi_vec : state_) {
-        new_state.push_back(std::vector<float>(phi_vec));
+void Kinematics::set_objective_weight(objective_t _objective, float _weight) {
+    switch (_objective) {
+        case LIMIT_AVOIDANCE: limit_avoidance_weight_ = _weight; break;
+        case REST_POSE:       rest_pose_weight_ = _weight; break;
+        case MANIPULABILITY:  manipulability_weight_ = _weight; break;
     }
-    return new_state;
+}
+
+
+void Kinematics::set_rest_pose(Span<const float> _pose) {
+    assert(_pose.size() == n_dofs_);
+    std::copy(_pose.begin(), _pose.end(), rest_pose_.begin());
+}
+
+
+std::vector<float> Kinematics::copy_state() {
+    return state_;
+}
+
+Span<const float> Kinematics::dofs(size_t _i) const {
+    return Span<const float>(state_.data() + dof_ranges_[_i].state_offset, dof_ranges_[_i].state_size);
+}
+
+void Kinematics::set_state(Span<const float> _state) {
+    assert(_state.size() == state_size_);
+    std::copy(_state.begin(), _state.end(), state_.begin());
+
+    // the history of the solver belongs to the previous state
+    forget_history();
+}
+
+std::vector<float> Kinematics::dof_values() const {
+    std::vector<float> values(n_dofs_);
+    coordinates(state_, values);
+    return values;
+}
+
+void Kinematics::set_dof_values(Span<const float> _values) {
+    assert(_values.size() == n_dofs_);
+    for (size_t i = 0; i < joints_.size(); i++) {
+        const Dof_range& range = dof_ranges_[i];
+        joints_[i].set_coordinates(_values.data() + range.offset,
+                                   Span<float>(state_.data() + range.state_offset, range.state_size));
+    }
+
+    forget_history();
+}
+
+void Kinematics::forget_history() {
+    has_last_step_ = false;
+    n_stalled_steps_ = 0u;
+    last_error_ = std::numeric_limits<double>::infinity();
+    damping_ = initial_damping_;
+    // seeding a mersenne twister costs microseconds, the next kick does it
+    perturbation_seeded_ = false;
 }
 
 void Kinematics::reset() {
-    unsigned int k = 0u;
-    for (int i = 0; i < state_.size(); i++) {
-        for (int j = 0; j < state_.at(i).size(); j++) {
-            state_.at(i).at(j) = 0.0f;
-        }
+    for (size_t i = 0; i < joints_.size(); i++) {
+        joints_[i].rest_state(Span<float>(state_.data() + dof_ranges_[i].state_offset, dof_ranges_[i].state_size));
     }
 }
 
 void Kinematics::step(const vec4 _target_location, float _time_step) {
+    Task task = {&_target_location, 1, nullptr};
+    step_towards(task, _time_step);
+}
+
+
+void Kinematics::step(const vec4 _target_location, const mat4 _target_orientation, float _time_step) {
+    Task task = {&_target_location, 1, &_target_orientation};
+    step_towards(task, _time_step);
+}
+
+
+void Kinematics::step(const std::vector<vec4>& _target_locations, float _time_step) {
+    assert(_target_locations.size() == n_end_effectors());
+    Task task = {_target_locations.data(), _target_locations.size(), nullptr};
+    step_towards(task, _time_step);
+}
+
+
+void Kinematics::step_towards(const Task& _task, float _time_step) {
     if (state_.empty()) {
         return;
     }
 
-    vec4 current_location = forward(state_).first;
-
-    arma::vec e_current;
-    e_current << current_location[0] << current_location[1] << current_location[2];
+    sweep(state_);
 
-    arma::vec e_target;
-    e_target << _target_location[0] << _target_location[1] << _target_location[2];
+    arma::vec& delta_e = delta_e_;
+    task_error(_task, delta_e);
+    const double error = arma::norm(delta_e);
 
-    arma::vec delta_e = e_target - e_current;
-  //  std::cout << "Distance to target: " << arma::norm(delta_e) << std::endl;
+    if (error < 0.001) {
+        return;
+    }
 
-    if (arma::norm(delta_e) < 0.001) {
+    if (heuristic_task(_task)) {
+        if (solver_ == FABRIK && _task.n_locations == 1) {
+            fabrik_pass(_task);
+        } else {
+            ccd_pass(_task);
+        }
         return;
     }
 
-    arma::vec delta_phi = arma::pinv(J3()) * delta_e;
+    if (solver_ == DAMPED_LEAST_SQUARES) {
+        adapt_damping();
+    }
+
+    jacobian(_task.n_locations, _task.orientation != nullptr, J_);
+    weight_rows(_task, J_);
 
-    // Automatic scaling of update to a maximal absolute change
-    float beta = max_change_ / std::max(max_change_, (float)arma::max(arma::abs(delta_phi)));
+    arma::vec& delta_phi = delta_phi_last_;
+    const bool has_null_motion = solve_task(delta_e, _time_step, delta_phi);
+
+    if (solver_ == DAMPED_LEAST_SQUARES) {
+        has_last_step_ = true;
+        last_target_locations_.assign(_task.locations, _task.locations + _task.n_locations);
+        last_step_oriented_ = _task.orientation != nullptr;
+        if (last_step_oriented_) {
+            last_target_orientation_ = *_task.orientation;
+        }
+        last_predicted_error_ = predicted_error(delta_e, delta_phi, _time_step);
+    }
+
+    if (has_null_motion) {
+        // keep the secondary motion only if it leaves at least half of the predicted progress,
+        // as in solve(), so the objectives do not keep the chain from reaching the target
+        const double required_error = 0.5 * (error + predicted_error(delta_e, delta_phi, _time_step));
+        delta_phi += null_motion_;
+        integrate(state_, delta_phi, _time_step, scratch_state_);
+        apply_limits(scratch_state_);
+        sweep(scratch_state_);
+        task_error(_task, candidate_e_);
+        if (arma::norm(candidate_e_) >= required_error) {
+            delta_phi -= null_motion_;
+        }
+    }
 
-    arma::vec phi_rand(n_dofs_); phi_rand.fill(0.0f);
-    if (arma::norm(delta_phi) < 0.1f) {
-        if (++n_small_updates_ >= 10) {
-            std::cout << "Local minimum? Perturbing...\n";
-            phi_rand.randu(n_dofs_);
-            n_small_updates_ = 0u;
+    // a chain in a local minimum takes small steps that do not reduce the error, after ten
+    // of them it is kicked by a random perturbation. Small steps that still make progress
+    // are normal close to the target. A clamped chain is expected to stop at its limits,
+    // it is not kicked out of them
+    const bool stalled = arma::norm(delta_phi) < 0.1f && error > 0.999 * last_error_;
+    if (stalled && !(has_limits_ && limit_handling_ == CLAMP_DOFS)) {
+        if (++n_stalled_steps_ >= 10) {
+            if (!perturbation_seeded_) {
+                perturbation_rng_.seed(std::mt19937::default_seed);
+                perturbation_seeded_ = true;
+            }
+            std::uniform_real_distribution<double> kick(0.0, 1.0);
+            for (size_t k = 0; k < n_dofs_; k++) {
+                delta_phi(k) += kick(perturbation_rng_);
+            }
+            n_stalled_steps_ = 0u;
         }
     } else {
-        n_small_updates_ = 0u;
+        n_stalled_steps_ = 0u;
     }
+    last_error_ = error;
+
+    integrate(state_, delta_phi, _time_step, state_);
+    apply_limits(state_);
+}
+
+
+Solve_outcome Kinematics::solve(const vec4& _target_location, const Solve_options& _options) {
+    Task task = {&_target_location, 1, nullptr};
+    return solve_towards(task, _options);
+}
+
+
+Solve_outcome Kinematics::solve(const vec4& _target_location, const mat4& _target_orientation, const Solve_options& _options) {
+    Task task = {&_target_location, 1, &_target_orientation};
+    return solve_towards(task, _options);
+}
+
+
+Solve_outcome Kinematics::solve(const std::vector<vec4>& _target_locations, const Solve_options& _options) {
+    assert(_target_locations.size() == n_end_effectors());
+    Task task = {_target_locations.data(), _target_locations.size(), nullptr};
+    return solve_towards(task, _options);
+}
+
 
-    unsigned int k = 0u;
-    for (int i = 0; i < state_.size(); i++) {
-        for (int j = 0; j < state_.at(i).size(); j++) {
-            state_.at(i).at(j) += _time_step * (float)(delta_phi(k) + phi_rand(k));
-            k++;
+Solve_outcome Kinematics::solve_towards(const Task& _task, const Solve_options& _options) {
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point start = clock::now();
+
+    Solve_outcome outcome;
+
+    sweep(state_);
+    arma::vec& delta_e = delta_e_;
+    task_error(_task, delta_e);
+    double error = arma::norm(delta_e);
+    unsigned int n_poor_steps = 0;
+
+    while (true) {
+        if (error <= _options.tolerance || state_.empty()) {
+            outcome.termination = CONVERGED;
+            break;
+        }
+        if (outcome.iterations >= _options.max_iterations) {
+            outcome.termination = MAX_ITERATIONS;
+            break;
+        }
+        if (_options.max_seconds > 0.0 &&
+            std::chrono::duration<double>(clock::now() - start).count() >= _options.max_seconds) {
+            outcome.termination = TIME_BUDGET;
+            break;
+        }
+        outcome.iterations++;
+
+        if (heuristic_task(_task)) {
+            // the passes need no line search, a pass that does not help counts as a poor step
+            if (solver_ == FABRIK && _task.n_locations == 1) {
+                fabrik_pass(_task);
+            } else {
+                ccd_pass(_task);
+            }
+            sweep(state_);
+            task_error(_task, delta_e);
+            outcome.forward_evaluations++;
+
+            const double improvement = error - arma::norm(delta_e);
+            error = arma::norm(delta_e);
+            if (improvement >= _options.min_improvement) {
+                n_poor_steps = 0;
+            } else if (++n_poor_steps >= _options.max_poor_steps) {
+                outcome.termination = STALLED;
+                break;
+            }
+            continue;
+        }
+
+        jacobian(_task.n_locations, _task.orientation != nullptr, J_);
+        weight_rows(_task, J_);
+
+        arma::vec& delta_phi = delta_phi_last_;
+        // the line search only shortens the full step
+        bool has_null_motion = solve_task(delta_e, 1.0f, delta_phi);
+
+        // the secondary objectives may use up at most half of the progress the task step predicts
+        double required_error = error;
+        if (has_null_motion) {
+            required_error = 0.5 * (error + predicted_error(delta_e, delta_phi, 1.0f));
+            delta_phi += null_motion_;
+        }
+
+        // backtracking line search, the candidate state lives in the scratch state
+        float alpha = 1.0f;
+        unsigned int n_backtracks = 0;
+        arma::vec& candidate_e = candidate_e_;
+        double candidate_error = error;
+        bool accepted = false;
+        while (true) {
+            integrate(state_, delta_phi, alpha, scratch_state_);
+            apply_limits(scratch_state_);
+            sweep(scratch_state_);
+            task_error(_task, candidate_e);
+            candidate_error = arma::norm(candidate_e);
+            outcome.forward_evaluations++;
+
+            if (candidate_error < required_error) {
+                accepted = true;
+                break;
+            }
+            if (has_null_motion) {
+                // drop the secondary motion before shortening the task step
+                delta_phi -= null_motion_;
+                has_null_motion = false;
+                required_error = error;
+                continue;
+            }
+            if (n_backtracks++ == _options.max_backtracks) {
+                break;
+            }
+            alpha *= 0.5f;
+        }
+
+        if (solver_ == DAMPED_LEAST_SQUARES) {
+            // a full step means the linearization holds, backtracking or rejection that it does not
+            if (accepted && alpha == 1.0f) {
+                damping_ = std::max(min_damping_, 0.5 * damping_);
+            } else {
+                damping_ = std::min(max_damping_, 2.0 * damping_);
+            }
+        }
+
+        if (!accepted) {
+            // more damping gives a shorter step closer to the gradient, try that before giving up
+            if (solver_ == DAMPED_LEAST_SQUARES && damping_ < max_damping_) {
+                continue;
+            }
+            outcome.termination = STALLED;
+            break;
+        }
+
+        std::copy(scratch_state_.begin(), scratch_state_.end(), state_.begin());
+        const double improvement = error - candidate_error;
+        delta_e = candidate_e;
+        error = candidate_error;
+
+        if (improvement >= _options.min_improvement) {
+            n_poor_steps = 0;
+        } else if (++n_poor_steps >= _options.max_poor_steps) {
+            outcome.termination = STALLED;
+            break;
         }
     }
+
+    // step() must not compare against a prediction made before this solve
+    has_last_step_ = false;
+    n_stalled_steps_ = 0u;
+    last_error_ = std::numeric_limits<double>::infinity();
+
+    outcome.residual = (float)error;
+    return outcome;
 }
 
 
-vec4 Kinematics::update_body_positions() {
-    std::pair<vec4, mat4> current_coordinates(origin_, mat4::rotate_x(-90.0f) * world_orientation_);
+bool Kinematics::aims_bones(size_t _joint) const {
+    return joints_[_joint].type_ == BALL_JOINT || joints_[_joint].type_ == HINGE_JOINT;
+}
 
-    if (state_.empty()) {
-        return current_coordinates.first;
+
+bool Kinematics::heuristic_task(const Task& _task) const {
+    return (solver_ == CYCLIC_COORDINATE_DESCENT || solver_ == FABRIK) && !_task.orientation;
+}
+
+
+void Kinematics::ccd_pass(const Task& _task) {
+    for (size_t e = 0; e < _task.n_locations; e++) {
+        // the axes of the current state, the passes for earlier end effectors moved them
+        collect_dof_axes();
+        const vec3 target(_task.locations[e][0], _task.locations[e][1], _task.locations[e][2]);
+        vec3 end_effector = end_frames_[effector_joint(e)].translation_;
+
+        // turning a joint does not move the axes of the joints closer to the root, and the DOFs
+        // of a joint turn around axes fixed in its base, so the axes collected above stay
+        // valid while the pass walks towards the root
+        for (int j = (int)effector_joint(e); j >= 0; j = parents_[j]) {
+            const Dof_range& range = dof_ranges_[j];
+            if (range.arity == 0) {
+                continue;
+            }
+            // the end effector moves rigidly with the end of the joint, whose frame is still
+            // the one of the last sweep, and the base of the joint stays where it is
+            const Rigid_transform& base = parents_[j] < 0 ? root_ : end_frames_[parents_[j]];
+            const vec3 local_end_effector = inverse(end_frames_[j]).apply_point(end_effector);
+            Span<float> joint_state(state_.data() + range.state_offset, range.state_size);
+            for (size_t k = range.offset; k < range.offset + range.arity; k++) {
+                const vec3& axis = dof_axes_[k];
+                const vec3& pivot = dof_pivots_[k];
+                vec3 from = end_effector - pivot;
+                vec3 to = target - pivot;
+                from -= dot(from, axis) * axis;
+                to -= dot(to, axis) * axis;
+                if (norm(from) < 1e-6f || norm(to) < 1e-6f) {
+                    continue;
+                }
+
+                // the angle that takes the end effector closest to the target, within the limits
+                float delta[Joint::max_arity] = {0.0f};
+                delta[k - range.offset] = rad2deg(atan2f(dot(axis, cross(from, to)), dot(from, to)));
+                joints_[j].integrate(dofs(j), delta, joint_state);
+                apply_joint_limits(j, state_);
+                end_effector = joints_[j].forward(base, dofs(j)).apply_point(local_end_effector);
+            }
+        }
+    }
+}
+
+
+void Kinematics::fabrik_pass(const Task& _task) {
+    sweep(state_);
+
+    path_joints_.clear();
+    for (int j = (int)effector_joint(0); j >= 0; j = parents_[j]) {
+        path_joints_.push_back(j);
+    }
+    std::reverse(path_joints_.begin(), path_joints_.end());
+
+    // only balls and hinges turn the bones after them, axial joints keep the direction, so the
+    // bones between two balls or hinges are one straight segment. Point 0 is the root, point i
+    // the end of the i'th segment
+    fabrik_points_.clear();
+    fabrik_lengths_.clear();
+    fabrik_points_.push_back(root_.translation_);
+    float segment_length = 0.0f;
+    float total_length = 0.0f;
+    size_t last_bone = 0;
+    for (size_t j : path_joints_) {
+        if (joints_[j].type_ == BONE_JOINT) {
+            segment_length += joints_[j].length_;
+            last_bone = j;
+        } else if (aims_bones(j) && segment_length > 0.0f) {
+            fabrik_points_.push_back(end_frames_[last_bone].translation_);
+            fabrik_lengths_.push_back(segment_length);
+            total_length += segment_length;
+            segment_length = 0.0f;
+        }
+    }
+    if (segment_length > 0.0f) {
+        fabrik_points_.push_back(end_frames_[last_bone].translation_);
+        fabrik_lengths_.push_back(segment_length);
+        total_length += segment_length;
+    }
+    const size_t n_segments = fabrik_lengths_.size();
+    if (n_segments == 0) {
+        return;
+    }
+
+    std::vector<vec3>& p = fabrik_points_;
+    const std::vector<float>& lengths = fabrik_lengths_;
+    const vec3 target(_task.locations[0][0], _task.locations[0][1], _task.locations[0][2]);
+
+    if (norm(target - p[0]) >= total_length) {
+        // out of reach, stretch the chain towards the target
+        for (size_t i = 0; i < n_segments; i++) {
+            p[i + 1] = p[i] + lengths[i] * normalize(target - p[i]);
+        }
+    } else {
+        // forward reaching from the target, then backward reaching from the fixed root
+        p[n_segments] = target;
+        for (size_t i = n_segments - 1; i > 0; i--) {
+            const vec3 d = p[i] - p[i + 1];
+            if (norm(d) > 0.0f) {
+                p[i] = p[i + 1] + lengths[i] * normalize(d);
+            }
+        }
+        for (size_t i = 0; i < n_segments; i++) {
+            const vec3 d = p[i + 1] - p[i];
+            if (norm(d) > 0.0f) {
+                p[i + 1] = p[i] + lengths[i] * normalize(d);
+            }
+        }
+    }
+
+    // back to joint angles: every ball and hinge points the next segment at its new end point,
+    // as far as the joint can, and the frames are rebuilt from the root with the new angles.
+    // Joints behind the last segment have nothing to point and keep their angles
+    Rigid_transform frame = root_;
+    size_t point = 0;
+    bool in_segment = false;
+    for (size_t n = 0; n < path_joints_.size(); n++) {
+        const size_t j = path_joints_[n];
+        if (joints_[j].type_ == BONE_JOINT) {
+            in_segment = true;
+        } else if (aims_bones(j)) {
+            if (in_segment) {
+                point++;
+                in_segment = false;
+            }
+            if (point < n_segments) {
+                // a hinge after the next bones bends in the plane normal to this joint's
+                // x axis, which then has to be normal to both segments
+                vec3 side(0.0f);
+                size_t next = n + 1;
+                while (next < path_joints_.size() && joints_[path_joints_[next]].type_ == BONE_JOINT) {
+                    next++;
+                }
+                if (next > n + 1 && next < path_joints_.size() && joints_[path_joints_[next]].type_ == HINGE_JOINT
+                    && point + 2 <= n_segments) {
+                    side = cross(p[point + 1] - p[point], p[point + 2] - p[point + 1]);
+                    if (dot(side, end_frames_[j].base_x()) < 0.0f) {
+                        side = -side;
+                    }
+                }
+
+                const Dof_range& range = dof_ranges_[j];
+                Span<float> joint_state(state_.data() + range.state_offset, range.state_size);
+                joints_[j].aim(frame, p[point + 1] - frame.translation_, side, joint_state);
+                apply_joint_limits(j, state_);
+            }
+        }
+        frame = joints_[j].forward(frame, dofs(j));
+    }
+}
+
+
+void Kinematics::task_error(const Task& _task, arma::vec& _delta_e) {
+    _delta_e.set_size(_task.rows());
+
+    for (size_t e = 0; e < _task.n_locations; e++) {
+        const vec3& current = end_frames_[effector_joint(e)].translation_;
+        for (int i = 0; i < 3; i++) {
+            _delta_e(3 * e + i) = position_weight_ * (_task.locations[e][i] - current[i]);
+        }
+    }
+
+    if (_task.orientation) {
+        // rotation that takes the current orientation onto the target, in world coordinates
+        const mat3& current = end_frames_[effector_joint(0)].rotation_;
+        vec3 rotation = rotation_log(mat3(*_task.orientation) * transpose(current));
+        const size_t row = 3 * _task.n_locations;
+        for (int i = 0; i < 3; i++) {
+            _delta_e(row + i) = orientation_weight_ * rotation[i];
+        }
     }
-    auto state_it = state_.begin();
+}
+
+
+double Kinematics::predicted_error(const arma::vec& _delta_e, const arma::vec& _delta_phi, float _scale) {
+    predicted_e_ = J_ * _delta_phi;
+    predicted_e_ *= -_scale;
+    predicted_e_ += _delta_e;
+    return arma::norm(predicted_e_);
+}
+
 
-    for (Object* object : model_) {
-        object->update_dof(*state_it);
-        object->update_position(current_coordinates.first, current_coordinates.second);
-        current_coordinates = object->forward(current_coordinates, *(state_it++));
+void Kinematics::weight_rows(const Task& _task, arma::mat& _J) {
+    const size_t position_rows = 3 * _task.n_locations;
+    _J.rows(0, position_rows - 1) *= position_weight_;
+    if (_task.orientation) {
+        _J.rows(position_rows, position_rows + 2) *= orientation_weight_;
     }
+}
+
+
+void Kinematics::solve(const arma::mat& _J, const arma::vec& _delta_e, arma::vec& _delta_phi) {
+    switch (solver_) {
+        case DAMPED_LEAST_SQUARES:
+            solve_damped(_J, _delta_e, _delta_phi);
+            break;
 
-    // return the end effector location
-    return current_coordinates.first;
+        case JACOBIAN_TRANSPOSE:
+        {
+            // step length that minimizes the linearized error along J^T e
+            _delta_phi = _J.t() * _delta_e;
+            arma::vec J_JT_e = _J * _delta_phi;
+            double denominator = arma::dot(J_JT_e, J_JT_e);
+            if (denominator <= 0.0) {
+                _delta_phi.zeros();
+            } else {
+                _delta_phi *= arma::dot(_delta_e, J_JT_e) / denominator;
+            }
+            break;
+        }
+
+        case PSEUDO_INVERSE:
+        default:
+            has_cholesky_ = false;
+            arma::pinv(J_pinv_, _J, singular_tolerance_);
+            _delta_phi = J_pinv_ * _delta_e;
+            break;
+    }
 }
 
 
-std::pair<vec4, mat4> Kinematics::forward(std::vector<std::vector<float>> _state) {
-    assert(!_state.empty());
+bool Kinematics::solve_task(const arma::vec& _delta_e, float _scale, arma::vec& _delta_phi) {
+    const bool clamping = has_limits_ && limit_handling_ == CLAMP_DOFS;
+    if (clamping) {
+        // scales to max_change_ itself, the limits are checked against the scaled step
+        solve_clamped(J_, _delta_e, state_, _scale, _delta_phi);
+    } else {
+        solve(J_, _delta_e, _delta_phi);
+
+        // Automatic scaling of update to a maximal absolute change
+        float beta = max_change_ / std::max(max_change_, (float)arma::max(arma::abs(_delta_phi)));
+        _delta_phi *= beta;
+    }
 
-    std::pair<vec4, mat4> current_coordinates(origin_, mat4::rotate_x(-90.0f) * world_orientation_);
-    auto state_it = _state.begin();
+    if (solver_ == JACOBIAN_TRANSPOSE || !objective_motion()) {
+        return false;
+    }
 
-    for (Object* object : model_) {
-        current_coordinates = object->forward(current_coordinates, *(state_it++));
+    // remove the part of the desired motion the task can see, J^+ J z, with the factorization
+    // of the primary solve. Clamped DOFs are not part of that solve and stay where they are.
+    const arma::mat& J = clamping ? J_free_ : J_;
+    task_rhs_ = J * null_motion_;
+    if (has_cholesky_) {
+        cholesky_solve(task_rhs_);
+        null_motion_ -= J.t() * task_rhs_;
+    } else {
+        null_motion_ -= J_pinv_ * task_rhs_;
+    }
+    if (clamping) {
+        for (size_t k = 0; k < n_dofs_; k++) {
+            if (clamped_[k]) null_motion_(k) = 0.0;
+        }
     }
 
-    return current_coordinates;
+    float gamma = max_change_ / std::max(max_change_, (float)arma::max(arma::abs(null_motion_)));
+    null_motion_ *= gamma;
+    return true;
 }
 
 
-arma::mat Kinematics::J3() {
-    arma::mat J(3, n_dofs_);
+bool Kinematics::objective_motion() {
+    const bool active = limit_avoidance_weight_ > 0.0f || rest_pose_weight_ > 0.0f || manipulability_weight_ > 0.0f;
+    if (!active) {
+        return false;
+    }
 
-    for (int i = 0; i < n_dofs_; i++) {
-        std::vector<float> de_dphi = derivative(i);
-        for (int j = 0; j < 3; j++) {
-            J(j, i) = de_dphi.at(j);
+    // differences of DOF coordinates, for a ball a first order approximation of the rotation
+    coordinates(state_, dof_values_);
+    for (size_t k = 0; k < n_dofs_; k++) {
+        double motion = 0.0;
+        if (limit_avoidance_weight_ > 0.0f && lower_limits_[k] > -std::numeric_limits<float>::infinity()
+                                           && upper_limits_[k] < std::numeric_limits<float>::infinity()) {
+            motion += limit_avoidance_weight_ * (0.5f * (lower_limits_[k] + upper_limits_[k]) - dof_values_[k]);
         }
+        if (rest_pose_weight_ > 0.0f) {
+            motion += rest_pose_weight_ * (rest_pose_[k] - dof_values_[k]);
+        }
+        null_motion_(k) = motion;
     }
 
-    return J;
+    if (manipulability_weight_ > 0.0f) {
+        add_manipulability_gradient(manipulability_weight_);
+    }
+    return true;
 }
 
-std::vector<float> Kinematics::derivative(unsigned int n) {
-    // make deep copy of state
-    std::vector<std::vector<float>> new_state = copy_state();
 
-    // change the k'th DOF by a little bit
-    unsigned int k = 0u;
-    for (int i = 0; i < new_state.size(); i++) {
-        for (int j = 0; j < new_state.at(i).size(); j++) {
-            if (k++ == n) {
-                new_state.at(i).at(j) += epsilon_;
+void Kinematics::add_manipulability_gradient(float _weight) {
+    // with the position Jacobian J (per radian) and A = J J^T,
+    // d log sqrt(det A) / d phi_k = sum_i b_i . dJ_i / d phi_k with b_i = A^-1 J_i,
+    // measured at the first end effector, DOFs off its path have a zero column
+    collect_dof_axes();
+    mark_path(0);
+    const vec3 end_effector = end_frames_[effector_joint(0)].translation_;
+
+    mat3 A(0.0f);
+    for (size_t i = 0; i < n_dofs_; i++) {
+        const vec3 column = on_path_[dof_joints_[i]] ? cross(dof_axes_[i], end_effector - dof_pivots_[i]) : vec3(0.0f);
+        position_columns_[i] = column;
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                A(r, c) += column[r] * column[c];
+            }
+        }
+    }
+    // keeps A invertible for chains that cannot move in all three directions
+    for (int r = 0; r < 3; r++) {
+        A(r, r) += 1e-6f;
+    }
+    const mat3 A_inv = inverse(A);
+    for (size_t i = 0; i < n_dofs_; i++) {
+        manipulability_b_[i] = A_inv * position_columns_[i];
+    }
+
+    for (size_t k = 0; k < n_dofs_; k++) {
+        const size_t joint_k = dof_joints_[k];
+        if (!on_path_[joint_k]) {
+            continue;
+        }
+        const vec3& J_k = position_columns_[k];
+        float gradient = 0.0f;
+        for (size_t i = 0; i < n_dofs_; i++) {
+            // turning DOF k either carries DOF i along, which rotates its whole column,
+            // or it only moves the end effector, by J_k. On one path a lower joint index
+            // is closer to the root, the axes within a joint are fixed in its base
+            const size_t joint_i = dof_joints_[i];
+            if (!on_path_[joint_i]) {
+                continue;
             }
+            const bool carries_i = joint_k < joint_i;
+            const vec3 dJ_i = carries_i ? cross(dof_axes_[k], position_columns_[i]) : cross(dof_axes_[i], J_k);
+            gradient += dot(manipulability_b_[i], dJ_i);
         }
+        // gradient per radian, scaled to a motion in degrees
+        null_motion_(k) += _weight * rad2deg(gradient);
     }
+}
 
-    std::pair<vec4, mat4> e_new = forward(new_state);
-    std::pair<vec4, mat4> e_old = forward(state_);
 
-    vec3 angles_new = rotationMatrixToEulerAngles(e_new.second);
-    vec3 angles_old = rotationMatrixToEulerAngles(e_old.second);
+double Kinematics::manipulability() {
+    collect_dof_axes();
+    mark_path(0);
+    const vec3 end_effector = end_frames_[effector_joint(0)].translation_;
 
-    std::vector<float> de_dphi;
-    for (int i = 0; i < 3; i++) {
-        de_dphi.push_back((e_new.first[i] - e_old.first[i]) / epsilon_);
+    arma::mat33 A(arma::fill::zeros);
+    for (size_t i = 0; i < n_dofs_; i++) {
+        if (!on_path_[dof_joints_[i]]) {
+            continue;
+        }
+        const vec3 column = cross(dof_axes_[i], end_effector - dof_pivots_[i]);
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                A(r, c) += column[r] * column[c];
+            }
+        }
     }
-    
-    for (int i = 0; i < 3; i++) {
-        de_dphi.push_back((angles_new[i] - angles_old[i]) / epsilon_);
+    return std::sqrt(std::max(0.0, arma::det(A)));
+}
+
+
+void Kinematics::solve_clamped(const arma::mat& _J, const arma::vec& _delta_e, const std::vector<float>& _state, float _scale,
+                               arma::vec& _delta_phi) {
+    J_free_ = _J;
+    clamped_step_.zeros();
+    std::fill(clamped_.begin(), clamped_.end(), 0);
+    clamped_residual_ = _delta_e;
+    // the limits are in DOF coordinates, for a ball the state moved by _delta_phi is
+    // compared to them to first order
+    coordinates(_state, dof_values_);
+
+    // every pass fixes at least one more DOF, so this ends after n_dofs_ passes at most
+    for (size_t pass = 0; pass <= n_dofs_; pass++) {
+        solve(J_free_, clamped_residual_, _delta_phi);
+
+        // scale the free DOFs to the maximal change. A clamped DOF moves no further than
+        // the scaled step that hit its limit, so it stays within the maximal change
+        float largest = 0.0f;
+        for (size_t k = 0; k < n_dofs_; k++) {
+            if (!clamped_[k]) largest = std::max(largest, (float)std::abs(_delta_phi(k)));
+        }
+        const float beta = max_change_ / std::max(max_change_, largest);
+
+        bool violated = false;
+        for (size_t k = 0; k < n_dofs_; k++) {
+            if (clamped_[k]) {
+                continue;
+            }
+            _delta_phi(k) *= beta;
+            const float target = dof_values_[k] + _scale * (float)_delta_phi(k);
+            if (target < lower_limits_[k] || target > upper_limits_[k]) {
+                // fix the DOF at the limit, the other DOFs take over the rest of its motion
+                clamped_[k] = 1;
+                clamped_step_(k) = (std::min(std::max(target, lower_limits_[k]), upper_limits_[k]) - dof_values_[k]) / _scale;
+                J_free_.col(k).zeros();
+                violated = true;
+            }
+        }
+        if (!violated) {
+            break;
+        }
+
+        clamped_residual_ = _J * clamped_step_;
+        clamped_residual_ *= -1.0;
+        clamped_residual_ += _delta_e;
+    }
+
+    for (size_t k = 0; k < n_dofs_; k++) {
+        if (clamped_[k]) {
+            _delta_phi(k) = clamped_step_(k);
+        }
+    }
+}
+
+
+void Kinematics::apply_limits(std::vector<float>& _state) const {
+    if (!has_limits_) {
+        return;
+    }
+    for (size_t i = 0; i < joints_.size(); i++) {
+        apply_joint_limits(i, _state);
+    }
+}
+
+
+void Kinematics::apply_joint_limits(size_t _joint, std::vector<float>& _state) const {
+    const Dof_range& range = dof_ranges_[_joint];
+    if (!has_limits_ || range.arity == 0) {
+        return;
+    }
+
+    // the limits are in DOF coordinates, a ball is only converted back if it was clamped
+    Span<float> joint_state(_state.data() + range.state_offset, range.state_size);
+    float values[Joint::max_arity];
+    joints_[_joint].coordinates(Span<const float>(joint_state.data(), range.state_size), values);
+    bool clamped = false;
+    for (size_t j = 0; j < range.arity; j++) {
+        const float value = std::min(std::max(values[j], lower_limits_[range.offset + j]), upper_limits_[range.offset + j]);
+        clamped = clamped || value != values[j];
+        values[j] = value;
+    }
+    if (clamped) {
+        joints_[_joint].set_coordinates(values, joint_state);
+    }
+}
+
+
+void Kinematics::integrate(const std::vector<float>& _state, const arma::vec& _delta_phi, float _scale, std::vector<float>& _result) const {
+    float delta[Joint::max_arity];
+    for (size_t i = 0; i < joints_.size(); i++) {
+        const Dof_range& range = dof_ranges_[i];
+        for (size_t j = 0; j < range.arity; j++) {
+            delta[j] = _scale * (float)_delta_phi(range.offset + j);
+        }
+        joints_[i].integrate(Span<const float>(_state.data() + range.state_offset, range.state_size), delta,
+                             Span<float>(_result.data() + range.state_offset, range.state_size));
+    }
+}
+
+
+void Kinematics::coordinates(const std::vector<float>& _state, std::vector<float>& _values) const {
+    for (size_t i = 0; i < joints_.size(); i++) {
+        const Dof_range& range = dof_ranges_[i];
+        joints_[i].coordinates(Span<const float>(_state.data() + range.state_offset, range.state_size),
+                               _values.data() + range.offset);
+    }
+}
+
+
+void Kinematics::solve_damped(const arma::mat& _J, const arma::vec& _delta_e, arma::vec& _delta_phi) {
+    // small task space system, 3x3 for position targets
+    // J * J.t() would transpose into a temporary, beyond 16 entries on the heap
+    J_transposed_ = _J.t();
+    arma::mat& A = damped_system_;
+    A = _J * J_transposed_;
+    A.diag() += damping_ * damping_;
+
+    has_cholesky_ = arma::chol(R_, A);
+    if (!has_cholesky_) {
+        arma::pinv(J_pinv_, _J, singular_tolerance_);
+        _delta_phi = J_pinv_ * _delta_e;
+        return;
     }
 
-    return de_dphi;
+    task_rhs_ = _delta_e;
+    cholesky_solve(task_rhs_);
+    _delta_phi = J_transposed_ * task_rhs_;
+}
+
+
+void Kinematics::cholesky_solve(arma::vec& _x) const {
+    // A = R^T R, forward substitution with R^T, then back substitution with R
+    const arma::uword n = R_.n_rows;
+    for (arma::uword i = 0; i < n; i++) {
+        double sum = _x(i);
+        for (arma::uword k = 0; k < i; k++) {
+            sum -= R_(k, i) * _x(k);
+        }
+        _x(i) = sum / R_(i, i);
+    }
+    for (arma::uword i = n; i-- > 0;) {
+        double sum = _x(i);
+        for (arma::uword k = i + 1; k < n; k++) {
+            sum -= R_(i, k) * _x(k);
+        }
+        _x(i) = sum / R_(i, i);
+    }
+}
+
+
+void Kinematics::adapt_damping() {
+    if (!has_last_step_) {
+        return;
+    }
+
+    // compare against the target of the last step, so a moving target does not count as failure
+    Task last_task = {last_target_locations_.data(), last_target_locations_.size(),
+                      last_step_oriented_ ? &last_target_orientation_ : nullptr};
+    task_error(last_task, candidate_e_);
+    double achieved = last_error_ - arma::norm(candidate_e_);
+    double predicted = last_error_ - last_predicted_error_;
+    if (predicted <= 0.0) {
+        return;
+    }
+
+    double rho = achieved / predicted;
+    if (rho > 0.75) {
+        damping_ = std::max(min_damping_, 0.5 * damping_);
+    } else if (rho < 0.25) {
+        damping_ = std::min(max_damping_, 2.0 * damping_);
+    }
+}
+
+
+Rigid_transform Kinematics::joint_frames(std::vector<Rigid_transform>& _frames) {
+    sweep(state_);
+
+    _frames.resize(joints_.size());
+    for (size_t i = 0; i < joints_.size(); i++) {
+        _frames[i] = parents_[i] < 0 ? root_ : end_frames_[parents_[i]];
+    }
+
+    return end_frames_[effector_joint(0)];
+}
+
+
+void Kinematics::sweep(const std::vector<float>& _state) {
+    assert(_state.size() == state_size_);
+
+    // a joint is recomputed if one of its DOFs differs from the last sweep or its parent
+    // was recomputed, so the frames of a state that did not change are free
+    for (size_t i = 0; i < joints_.size(); i++) {
+        const Dof_range& range = dof_ranges_[i];
+        bool dirty = !frames_valid_ || (parents_[i] >= 0 && dirty_[parents_[i]]);
+        const size_t end = range.state_offset + range.state_size;
+        for (size_t k = range.state_offset; !dirty && k < end; k++) {
+            dirty = _state[k] != swept_state_[k];
+        }
+        dirty_[i] = dirty;
+        if (!dirty) {
+            continue;
+        }
+
+        std::copy(_state.begin() + range.state_offset, _state.begin() + end, swept_state_.begin() + range.state_offset);
+        const Rigid_transform& base = parents_[i] < 0 ? root_ : end_frames_[parents_[i]];
+        Span<const float> joint_state(_state.data() + range.state_offset, range.state_size);
+        end_frames_[i] = joints_[i].forward(base, joint_state);
+    }
+    frames_valid_ = true;
+}
+
+
+Rigid_transform Kinematics::forward(const std::vector<float>& _state) {
+    if (joints_.empty()) {
+        return root_;
+    }
+    sweep(_state);
+    return end_frames_[effector_joint(0)];
+}
+
+
+void Kinematics::mark_path(size_t _effector) {
+    std::fill(on_path_.begin(), on_path_.end(), 0);
+    for (int j = (int)effector_joint(_effector); j >= 0; j = parents_[j]) {
+        on_path_[j] = 1;
+    }
+}
+
+
+void Kinematics::jacobian(unsigned int _rows, arma::mat& _J) {
+    assert(_rows == 3 || _rows == 6);
+    jacobian(1, _rows == 6, _J);
+}
+
+
+void Kinematics::jacobian(size_t _n_effectors, bool _oriented, arma::mat& _J) {
+    assert(_n_effectors >= 1 && _n_effectors <= n_end_effectors());
+
+    // no reallocation if _J already has the right size
+    _J.set_size(3 * _n_effectors + (_oriented ? 3 : 0), n_dofs_);
+
+    switch (jacobian_mode_) {
+        case FINITE_DIFFERENCES:
+            jacobian_finite_differences(_n_effectors, _oriented, _J);
+            break;
+        case ANALYTIC:
+        default:
+            jacobian_analytic(_n_effectors, _oriented, _J);
+            break;
+    }
+}
+
+
+void Kinematics::jacobian_finite_differences(size_t _n_effectors, bool _oriented, arma::mat& _J) {
+    // the frames of the current state are cached. Turning a DOF moves the subtree of its
+    // joint rigidly with the end of the joint, so instead of sweeping the subtree again
+    // the end effectors are moved by the change of that one frame
+    sweep(state_);
+    std::copy(state_.begin(), state_.end(), scratch_state_.begin());
+    for (unsigned int i = 0; i < n_dofs_; i++) {
+        dof_perturbations_[i] = perturbation(i);
+    }
+
+    _J.zeros();
+    for (size_t e = 0; e < _n_effectors; e++) {
+        mark_path(e);
+        const vec3& e_old = end_frames_[effector_joint(e)].translation_;
+        for (unsigned int i = 0; i < n_dofs_; i++) {
+            if (!on_path_[dof_joints_[i]]) {
+                continue;
+            }
+            const vec3 e_new = dof_perturbations_[i].apply_point(e_old);
+            for (int j = 0; j < 3; j++) {
+                _J(3 * e + j, i) = (e_new[j] - e_old[j]) / epsilon_;
+            }
+        }
+    }
+
+    if (_oriented) {
+        // small rotation from the old to the new orientation, Euler angle differences
+        // would depend on the gimbal configuration
+        mark_path(0);
+        const size_t row = 3 * _n_effectors;
+        for (unsigned int i = 0; i < n_dofs_; i++) {
+            if (!on_path_[dof_joints_[i]]) {
+                continue;
+            }
+            vec3 rotation = rotation_log(dof_perturbations_[i].rotation_);
+            for (int j = 0; j < 3; j++) {
+                _J(row + j, i) = rotation[j] / epsilon_;
+            }
+        }
+    }
+}
+
+void Kinematics::collect_dof_axes() {
+    // the rotation axis and pivot of every DOF, from the cached frames of the current state
+    sweep(state_);
+    for (size_t i = 0; i < joints_.size(); i++) {
+        const Rigid_transform& base = parents_[i] < 0 ? root_ : end_frames_[parents_[i]];
+        const Dof_range& range = dof_ranges_[i];
+        joints_[i].dof_axes(base, dofs(i), &dof_axes_[range.offset]);
+        for (size_t j = 0; j < range.arity; j++) {
+            dof_pivots_[range.offset + j] = base.translation_;
+        }
+    }
+}
+
+
+void Kinematics::jacobian_analytic(size_t _n_effectors, bool _oriented, arma::mat& _J) {
+    collect_dof_axes();
+
+    // a rotation of d_phi degrees around axis a through p moves the end effector e by
+    // a x (e - p) * d_phi in radians, and turns it by a * d_phi in radians.
+    // DOFs that are not on the path from the root to an end effector do not move it
+    const float per_degree = deg2rad(1.0f);
+    for (size_t e = 0; e < _n_effectors; e++) {
+        mark_path(e);
+        const vec3 end_effector = end_frames_[effector_joint(e)].translation_;
+        for (unsigned int i = 0; i < n_dofs_; i++) {
+            const bool moves = on_path_[dof_joints_[i]] != 0;
+            vec3 de_dphi = moves ? per_degree * cross(dof_axes_[i], end_effector - dof_pivots_[i]) : vec3(0.0f);
+            for (int j = 0; j < 3; j++) {
+                _J(3 * e + j, i) = de_dphi[j];
+            }
+            // the orientation rows belong to the first end effector
+            if (_oriented && e == 0) {
+                const size_t row = 3 * _n_effectors;
+                for (int j = 0; j < 3; j++) {
+                    _J(row + j, i) = moves ? per_degree * dof_axes_[i][j] : 0.0f;
+                }
+            }
+        }
+    }
+}
+
+Rigid_transform Kinematics::perturbation(unsigned int _n) {
+    // change the n'th DOF by a little bit, scratch_state_ holds the current state
+    const size_t joint = dof_joints_[_n];
+    const Dof_range& range = dof_ranges_[joint];
+    const Rigid_transform& base = parents_[joint] < 0 ? root_ : end_frames_[parents_[joint]];
+
+    float delta[Joint::max_arity] = {0.0f};
+    delta[_n - range.offset] = epsilon_;
+    Span<float> perturbed_state(scratch_state_.data() + range.state_offset, range.state_size);
+    joints_[joint].integrate(dofs(joint), delta, perturbed_state);
+    Rigid_transform perturbed = joints_[joint].forward(base, Span<const float>(perturbed_state.data(), range.state_size));
+    std::copy(dofs(joint).begin(), dofs(joint).end(), perturbed_state.begin());
+
+    return perturbed * inverse(end_frames_[joint]);
 }
@@ -7,59 +7,470 @@
 #define KINEMATICS_H
 //=============================================================================
 
+#include <limits>
+#include <random>
 #include <vector>
-#include <utility>
 #include "glmath.h"
-#include "object/object.h"
+#include "rigid_transform.h"
+#include "joint/joint.h"
+#include "span.h"
 #include "armadillo"
 
-class Math_Object;
+/// how the Jacobian of the chain is evaluated
+enum jacobian_mode_t {FINITE_DIFFERENCES, ANALYTIC};
 
-class Kinematics {
-public:
-    std::vector<Object*> model_ = std::vector<Object*>();
+/// how step() turns the task space error into a state update.
+/// CYCLIC_COORDINATE_DESCENT and FABRIK work without a Jacobian, one step is one pass
+/// over the chain and ignores the time step. FABRIK moves the first end effector only,
+/// tasks with several end effectors use CCD. Both solve positions, targets with an
+/// orientation are solved with the pseudo-inverse
+enum solver_t {PSEUDO_INVERSE, DAMPED_LEAST_SQUARES, JACOBIAN_TRANSPOSE, CYCLIC_COORDINATE_DESCENT, FABRIK};
+
+/// how the solvers keep the state within the DOF limits
+enum limit_handling_t {
+    /// the solver ignores the limits, the state is clamped to them after every update
+    PROJECT_STATE,
+    /// DOFs that would leave their range are fixed at the limit and the rest is solved again,
+    /// without random perturbations when the chain gets stuck
+    CLAMP_DOFS
+};
+
+/// secondary objectives, pursued in the null space of the task so they never disturb it
+enum objective_t {
+    /// pulls every limited DOF towards the middle of its range
+    LIMIT_AVOIDANCE,
+    /// pulls the state towards the rest pose
+    REST_POSE,
+    /// climbs the gradient of log sqrt(det(J J^T)) of the position rows, away from singularities
+    MANIPULABILITY
+};
+
+/// why solve() returned
+enum termination_t {CONVERGED, MAX_ITERATIONS, TIME_BUDGET, STALLED};
+
+/// tolerance and budget of one solve() call
+struct Solve_options {
+    /// task space error at which the target counts as reached
+    float tolerance = 1e-3f;
+    /// upper bound on the number of accepted or rejected steps
+    unsigned int max_iterations = 100;
+    /// wall clock budget in seconds, 0 for no limit
+    double max_seconds = 0.0;
+    /// how often a step that does not reduce the error is halved before it is rejected
+    unsigned int max_backtracks = 4;
+    /// the solve has stalled after max_poor_steps accepted steps in a row that
+    /// reduced the error by less than min_improvement
+    float min_improvement = 1e-6f;
+    unsigned int max_poor_steps = 3;
+};
+
+/// what one solve() call did
+struct Solve_outcome {
+    /// number of solver iterations, one Jacobian evaluation each
+    unsigned int iterations = 0;
+    /// forward passes spent on the line search
+    unsigned int forward_evaluations = 0;
+    /// task space error of the final state
+    float residual = 0.0f;
+    termination_t termination = MAX_ITERATIONS;
+};
+
+/// location of one object's DOFs: offset and arity are its columns of the Jacobian and
+/// its entries of the per DOF vectors, state_offset and state_size its values in the flat state
+struct Dof_range {
+    size_t offset;
+    size_t arity;
+    size_t state_offset;
+    size_t state_size;
+};
 
+/// A skeleton of joints, either a single chain or a tree with several end effectors.
+/// The joints are stored in topological order, every joint after its parent, so the
+/// forward kinematics of all end effectors is one linear sweep over joints_.
+class Kinematics {
 private:
+    /// the skeleton, every joint after its parent
+    std::vector<Joint> joints_;
+
+    /// index of the parent of every joint, -1 for joints at the root
+    std::vector<int> parents_;
+
+    /// joints whose end frames are the end effectors, empty for the end of the last joint
+    std::vector<size_t> effectors_;
+
+    /// frame at the end of every joint, written by the last sweep
+    std::vector<Rigid_transform> end_frames_;
+
+    /// the state end_frames_ belong to, and the joints the last sweep recomputed
+    std::vector<float> swept_state_;
+    std::vector<char> dirty_;
+    bool frames_valid_ = false;
+
+    /// scratch space: the joints on the path from the root to one end effector
+    std::vector<char> on_path_;
+
+    /// scratch space of the finite-difference Jacobian, the change of the end frame of
+    /// the joint of every DOF when the DOF is perturbed
+    std::vector<Rigid_transform> dof_perturbations_;
+
     float epsilon_ = 1e-3f;
 
     /// Largest allowed change in any state, currently in degrees
     float max_change_ = 5.0f;
 
-    vec4 origin_ = vec4(0.0f, 0.0f, 0.0f, 1.0f);
-    mat4 world_orientation_ = mat4::identity();
+    /// singular values of the Jacobian below this are treated as zero, the chain
+    /// is evaluated in single precision so anything smaller is rounding noise
+    double singular_tolerance_ = 1e-6;
+
+    /// frame at the root of the chain, the chain starts along the world's y axis
+    Rigid_transform root_ = Rigid_transform::rotate_x(-90.0f);
 
-    std::vector<std::vector<float>> state_;
+    /// state of all joints, back to back in the order of joints_: one angle per DOF,
+    /// a quaternion for a ball
+    std::vector<float> state_;
+    /// where the DOFs of joints_[i] live in the Jacobian and in state_
+    std::vector<Dof_range> dof_ranges_;
     size_t n_dofs_ = 0;
+    size_t state_size_ = 0;
+
+    /// scratch space: the state in DOF coordinates, see dof_values()
+    std::vector<float> dof_values_;
+
+    /// range of every DOF in degrees, in DOF coordinates, unbounded by default
+    std::vector<float> lower_limits_;
+    std::vector<float> upper_limits_;
+    bool has_limits_ = false;
+    limit_handling_t limit_handling_ = PROJECT_STATE;
+
+    /// weights of the secondary objectives, 0 switches an objective off
+    float limit_avoidance_weight_ = 0.0f;
+    float rest_pose_weight_ = 0.0f;
+    float manipulability_weight_ = 0.0f;
+    std::vector<float> rest_pose_;
 
+    /// factorization of the last primary solve, reused to project the secondary
+    /// objectives: the Cholesky factor of J J^T + damping^2 I for DLS, pinv(J) otherwise
+    arma::mat R_;
+    arma::mat J_pinv_;
+    bool has_cholesky_ = false;
+
+    /// scratch space of the secondary objectives
+    arma::vec null_motion_;
+    std::vector<size_t> dof_joints_;
+    std::vector<vec3> position_columns_;
+    std::vector<vec3> manipulability_b_;
+
+    /// scratch space of the clamped solve
+    arma::mat J_free_;
+    arma::vec clamped_step_;
+    arma::vec clamped_residual_;
+    std::vector<char> clamped_;
+
+    /// preallocated copy of state_ for perturbing single DOFs and for candidate states
+    std::vector<float> scratch_state_;
+
+    /// Jacobian and state update of the last step, kept to reuse their memory
+    arma::mat J_;
     arma::vec delta_phi_last_;
-    unsigned int n_small_updates_;
+    /// task space scratch of a step: the error, the error of a candidate state, the
+    /// error the linearization predicts, J J^T + damping^2 I, J^T and the right hand
+    /// side of the Cholesky solves. Kept so a step allocates nothing
+    arma::vec delta_e_;
+    arma::vec candidate_e_;
+    arma::vec predicted_e_;
+    arma::mat damped_system_;
+    arma::mat J_transposed_;
+    arma::vec task_rhs_;
+    /// steps in a row that were small and did not reduce the error, see step_towards()
+    unsigned int n_stalled_steps_ = 0;
+    /// random perturbations of stalled chains, seeded again with the solver history, so
+    /// the solution only depends on the state and the targets. Seeded by the first kick
+    /// after the history was forgotten
+    std::mt19937 perturbation_rng_;
+    bool perturbation_seeded_ = false;
+
+    jacobian_mode_t jacobian_mode_ = ANALYTIC;
+
+    solver_t solver_ = DAMPED_LEAST_SQUARES;
+
+    /// scratch space of FABRIK: the joints from the root to the end effector, the
+    /// positions of the root and of the end of every straight segment, and the segment lengths
+    std::vector<size_t> path_joints_;
+    std::vector<vec3> fabrik_points_;
+    std::vector<float> fabrik_lengths_;
+
+    /// damping of the least-squares solve, adapted between min and max by the
+    /// ratio of achieved to predicted error reduction of the previous step
+    double initial_damping_ = 0.01;
+    double damping_ = 0.01;
+    double min_damping_ = 1e-4;
+    double max_damping_ = 1.0;
+
+    /// target and predicted error of the previous damped step
+    bool has_last_step_ = false;
+    std::vector<vec4> last_target_locations_;
+    mat4 last_target_orientation_;
+    bool last_step_oriented_ = false;
+    double last_predicted_error_ = 0.0;
+
+    /// error before the previous step of a Jacobian solver, infinity after the state was set
+    double last_error_ = std::numeric_limits<double>::infinity();
+
+    /// task space metric, the position and orientation rows of the error and
+    /// the Jacobian are scaled by these (orientation errors are in radians)
+    float position_weight_ = 1.0f;
+    float orientation_weight_ = 1.0f;
+
+    /// scratch space for the analytic Jacobian, one entry per DOF
+    std::vector<vec3> dof_axes_;
+    std::vector<vec3> dof_pivots_;
 public:
 
-    void add_object(Object* obj);
+    /// appends a joint at the end of the chain in its rest state, returns its index
+    size_t add_joint(const Joint& _joint);
+
+    /// adds a joint whose base is the end of joint _parent, or the root for -1,
+    /// returns its index. Several joints with the same parent make a tree.
+    size_t add_joint(const Joint& _joint, int _parent);
+
+    size_t n_joints() const { return joints_.size(); }
+
+    /// index of the parent of joint _i, -1 at the root
+    int parent(size_t _i) const { return parents_[_i]; }
+
+    /// makes the end of joint _joint an end effector, returns the index of the end effector.
+    /// Without any call the end of the last joint is the only end effector.
+    size_t add_end_effector(size_t _joint);
+
+    size_t n_end_effectors() const { return effectors_.empty() ? 1 : effectors_.size(); }
+
+    /// the joint whose end is end effector _i
+    size_t effector_joint(size_t _i) const { return effectors_.empty() ? joints_.size() - 1 : effectors_[_i]; }
+
+    const Joint& joint(size_t _i) const { return joints_[_i]; }
+
+    std::vector<float> copy_state();
+
+    /// the state of joints_[_i] in the current state
+    Span<const float> dofs(size_t _i) const;
+
+    /// where the DOFs of joints_[_i] live in the Jacobian and in a flat state
+    const Dof_range& dof_range(size_t _i) const { return dof_ranges_[_i]; }
+
+    /// number of DOFs, the columns of the Jacobian
+    size_t n_dofs() const { return n_dofs_; }
+
+    /// number of floats of the flat state, a ball has 3 DOFs but 4 floats
+    size_t state_size() const { return state_size_; }
+
+    /// the flat state of all joints
+    Span<const float> state() const { return Span<const float>(state_.data(), state_size_); }
 
-    void gl_setup(GL_Context& ctx);
+    /// the current state in DOF coordinates, n_dofs() values in degrees: the angles of
+    /// hinges and axial joints, the rotation vector of a ball
+    std::vector<float> dof_values() const;
 
-    std::vector<std::vector<float>> copy_state();
+    /// sets the state from DOF coordinates and forgets the solver history
+    void set_dof_values(Span<const float> _values);
+
+    /// limits every DOF of joints_[_i] to [_lower, _upper] degrees
+    void set_limits(size_t _i, float _lower, float _upper);
+
+    /// per DOF limits of joints_[_i], both spans have its arity
+    void set_limits(size_t _i, Span<const float> _lower, Span<const float> _upper);
+
+    float lower_limit(size_t _dof) const { return lower_limits_[_dof]; }
+    float upper_limit(size_t _dof) const { return upper_limits_[_dof]; }
+
+    void set_limit_handling(limit_handling_t _handling) { limit_handling_ = _handling; }
+
+    /// weight of a secondary objective, 0 (the default) switches it off. The objectives
+    /// are used by the pseudo-inverse and the damped least-squares solver
+    void set_objective_weight(objective_t _objective, float _weight);
+
+    /// state in DOF coordinates the REST_POSE objective pulls towards, all zeros by default
+    void set_rest_pose(Span<const float> _pose);
+
+    /// sqrt(det(J J^T)) of the position rows in the current state, 0 at a singularity
+    double manipulability();
+
+    /// overwrites the flat state and forgets the solver history, including the adapted
+    /// damping, _state has to hold state_size() values
+    void set_state(Span<const float> _state);
+
+    /// frame of the first end effector in the current state
+    Rigid_transform end_effector() { return forward(state_); }
+
+    /// frame of end effector _i in the current state
+    Rigid_transform end_effector(size_t _i) { sweep(state_); return end_frames_[effector_joint(_i)]; }
 
     void reset();
 
     /// solves the inverse kinematics problem and sets the new mathematical state
     void step(const vec4 _target_location, float _time_step);
 
+    /// one step towards a location for every end effector, the rows of all end effectors are solved together
+    void step(const std::vector<vec4>& _target_locations, float _time_step);
+
+    /// iterates towards the target until the error is below _options.tolerance or the budget
+    /// is used up. Starts from the current state, i.e. the previous solution, and keeps the
+    /// damping adapted by the previous call. Every step is checked by a backtracking line
+    /// search, a step that does not reduce the error is never applied.
+    Solve_outcome solve(const vec4& _target_location, const Solve_options& _options);
+
+    /// the same with a target orientation, the residual includes the weighted orientation error
+    Solve_outcome solve(const vec4& _target_location, const mat4& _target_orientation, const Solve_options& _options);
+
+    /// solve() with a location for every end effector, the residual is the error of all of them
+    Solve_outcome solve(const std::vector<vec4>& _target_locations, const Solve_options& _options);
+
     /// solves the inverse kinematics problem and sets the new mathematical state
     void step(const vec4 _target_location, const mat4 _target_orientation, float _time_step);
 
-    /// updates the location and orientation of the objects, return the current end effector
-    vec4 update_body_positions();
+    /// writes the frame at the base of every joint in the current state into _frames,
+    /// returns the frame of the first end effector
+    Rigid_transform joint_frames(std::vector<Rigid_transform>& _frames);
+
+    void set_jacobian_mode(jacobian_mode_t _mode) { jacobian_mode_ = _mode; }
+
+    void set_solver(solver_t _solver) { solver_ = _solver; has_last_step_ = false; }
+
+    void set_task_weights(float _position_weight, float _orientation_weight) {
+        position_weight_ = _position_weight;
+        orientation_weight_ = _orientation_weight;
+        has_last_step_ = false;
+    }
+
+    /// 3 DOF Jacobian of current state, evaluated according to the jacobian mode
+    arma::mat J3() { arma::mat J; jacobian(3, J); return J; }
+
+    /// 6 DOF Jacobian of current state, position rows followed by angular velocity rows
+    arma::mat J6() { arma::mat J; jacobian(6, J); return J; }
+
+    /// forward kinematics of a flat state laid out like state_, returns the frame of the
+    /// first end effector, does not allocate
+    Rigid_transform forward(const std::vector<float>& _state);
+
+    /// Jacobian of the first end effector in the current state with the first _rows of
+    /// (position, orientation) rows, written into _J, does not allocate if _J has the right size already
+    void jacobian(unsigned int _rows, arma::mat& _J);
+
+    /// stacked Jacobian of the current state: the position rows of the first _n_effectors
+    /// end effectors, followed by the orientation rows of the first one if _oriented
+    void jacobian(size_t _n_effectors, bool _oriented, arma::mat& _J);
 
 protected:
 
-    std::pair<vec4, mat4> forward(std::vector<std::vector<float>> _state);
+    /// targets of one step or solve: a location for each of the first n_locations end
+    /// effectors, and an orientation for the first one if orientation is set
+    struct Task {
+        const vec4* locations;
+        size_t n_locations;
+        const mat4* orientation;
+
+        unsigned int rows() const { return 3 * n_locations + (orientation ? 3 : 0); }
+    };
+
+    /// forward kinematics of all joints of _state into end_frames_, one pass in topological order.
+    /// Only the joints whose DOFs changed since the last sweep, and their subtrees, are recomputed
+    void sweep(const std::vector<float>& _state);
+
+    /// marks the joints from the root to end effector _effector in on_path_
+    void mark_path(size_t _effector);
+
+    /// Jacobian by finite differences on the cached frames, one joint evaluation per DOF
+    void jacobian_finite_differences(size_t _n_effectors, bool _oriented, arma::mat& _J);
+
+    /// Jacobian from the DOF axes collected in a single forward pass
+    void jacobian_analytic(size_t _n_effectors, bool _oriented, arma::mat& _J);
+
+    /// fills dof_axes_, dof_pivots_ and end_frames_ for the current state
+    void collect_dof_axes();
+
+    /// resets the damping, the stall detection and the perturbations to how a new chain starts
+    void forget_history();
+
+    /// task update for the error _delta_e with the Jacobian in J_, scaled to max_change_,
+    /// to be applied as _scale * _delta_phi. If secondary objectives are active their motion,
+    /// projected by (I - J^+ J) with J^+ from the factorization of the task solve, is written
+    /// to null_motion_ and true returned
+    bool solve_task(const arma::vec& _delta_e, float _scale, arma::vec& _delta_phi);
+
+    /// desired state change in degrees of all secondary objectives, written to null_motion_,
+    /// returns false if none is active
+    bool objective_motion();
+
+    /// adds the weighted gradient of the log manipulability to null_motion_
+    void add_manipulability_gradient(float _weight);
+
+    /// true if _task is solved by CCD or FABRIK instead of a Jacobian based solver
+    bool heuristic_task(const Task& _task) const;
+
+    /// one cyclic coordinate descent pass over the path of every end effector of _task:
+    /// each DOF, from the end effector towards the root, turns the end effector as close
+    /// to the target as its limits allow
+    void ccd_pass(const Task& _task);
+
+    /// one FABRIK iteration for the first end effector of _task on the ends of the straight
+    /// segments of the path, after which every ball and hinge is turned to point its
+    /// segment at the new end point
+    void fabrik_pass(const Task& _task);
+
+    /// true if joint _joint turns the direction of the bones after it, i.e. a ball or a hinge
+    bool aims_bones(size_t _joint) const;
+
+    /// one solver step towards the targets of _task
+    void step_towards(const Task& _task, float _time_step);
+
+    /// the iteration of solve()
+    Solve_outcome solve_towards(const Task& _task, const Solve_options& _options);
+
+    /// weighted task space error from the end effectors in end_frames_ to the targets of _task,
+    /// written to _delta_e
+    void task_error(const Task& _task, arma::vec& _delta_e);
+
+    /// norm of the error the linearization predicts after moving by _scale * _delta_phi,
+    /// i.e. of _delta_e - _scale * J_ * _delta_phi
+    double predicted_error(const arma::vec& _delta_e, const arma::vec& _delta_phi, float _scale);
+
+    /// applies the task space metric to the rows of _J, a Jacobian of _task
+    void weight_rows(const Task& _task, arma::mat& _J);
+
+    /// state update that reduces the task space error _delta_e, according to the solver
+    void solve(const arma::mat& _J, const arma::vec& _delta_e, arma::vec& _delta_phi);
+
+    /// solve() scaled to max_change_ that keeps _state moved by _scale * _delta_phi, the step
+    /// that is taken, within the limits, by fixing violating DOFs at their limit and solving
+    /// again for the remaining error with the free DOFs
+    void solve_clamped(const arma::mat& _J, const arma::vec& _delta_e, const std::vector<float>& _state, float _scale,
+                       arma::vec& _delta_phi);
+
+    /// clamps every DOF of _state to its limits
+    void apply_limits(std::vector<float>& _state) const;
+
+    /// clamps the DOFs of joints_[_joint] in _state to their limits
+    void apply_joint_limits(size_t _joint, std::vector<float>& _state) const;
+
+    /// _state moved by _scale * _delta_phi, one change in degrees per DOF, written to _result,
+    /// which may be _state itself
+    void integrate(const std::vector<float>& _state, const arma::vec& _delta_phi, float _scale, std::vector<float>& _result) const;
+
+    /// _state in DOF coordinates, n_dofs_ values written to _values
+    void coordinates(const std::vector<float>& _state, std::vector<float>& _values) const;
+
+    /// solves (J J^T + damping^2 I) y = _delta_e by Cholesky, the update is J^T y
+    void solve_damped(const arma::mat& _J, const arma::vec& _delta_e, arma::vec& _delta_phi);
+
+    /// solves R_^T R_ x = _x in place, R_ holds the Cholesky factor of the last damped solve
+    void cholesky_solve(arma::vec& _x) const;
 
-    /// 3 DOF Jacobian of current state
-    arma::mat J3();
+    /// grows or shrinks the damping depending on how well the last step did,
+    /// end_frames_ has to hold the current state
+    void adapt_damping();
 
-    std::vector<float> derivative(unsigned int i);
+    /// world space change of the end frame of the joint of DOF _n when the DOF grows by epsilon_,
+    /// end_frames_ and scratch_state_ have to hold the current state
+    Rigid_transform perturbation(unsigned int _n);
 
 };
 
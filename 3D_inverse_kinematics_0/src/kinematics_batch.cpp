@@ -0,0 +1,86 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include "kinematics_batch.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+//=============================================================================
+
+
+Kinematics_batch::Kinematics_batch(const Kinematics& _prototype) :
+    prototype_(_prototype)
+{
+#ifdef _OPENMP
+    workers_.assign(omp_get_max_threads(), prototype_);
+#else
+    workers_.assign(1, prototype_);
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Kinematics_batch::solve(const std::vector<vec4>& _targets, std::vector<float>& _states, unsigned int _max_steps)
+{
+    const size_t n_chains = _targets.size();
+    const size_t state_size = prototype_.state_size();
+
+    if (_states.size() != n_chains * state_size) {
+        _states.resize(n_chains * state_size);
+        Span<const float> initial = prototype_.state();
+        for (size_t c = 0; c < n_chains; c++) {
+            std::copy(initial.begin(), initial.end(), _states.begin() + c * state_size);
+        }
+    }
+
+    errors_.resize(n_chains);
+    steps_.resize(n_chains);
+
+#ifdef _OPENMP
+    // the thread count may have been raised since the constructor, one worker per thread
+    const size_t n_threads = omp_get_max_threads();
+    if (workers_.size() < n_threads) {
+        workers_.resize(n_threads, prototype_);
+    }
+#endif
+
+    // chains converge after very different numbers of steps, hand them out in small chunks.
+    // The team is never larger than the workers, whatever the thread count is set to
+    #pragma omp parallel for schedule(dynamic, 16) num_threads(workers_.size())
+    for (long c = 0; c < (long)n_chains; c++) {
+#ifdef _OPENMP
+        Kinematics& chain = workers_[omp_get_thread_num()];
+#else
+        Kinematics& chain = workers_[0];
+#endif
+        float* state = _states.data() + c * state_size;
+        const vec3 target = vec3(_targets[c][0], _targets[c][1], _targets[c][2]);
+
+        // also resets the damping and the perturbations left by the worker's previous chain
+        chain.set_state(Span<const float>(state, state_size));
+
+        unsigned int step = 0;
+        float error = norm(chain.end_effector().translation_ - target);
+        while (error > tolerance_ && step < _max_steps) {
+            chain.step(_targets[c], 1.0f);
+            error = norm(chain.end_effector().translation_ - target);
+            step++;
+        }
+
+        Span<const float> solved = chain.state();
+        std::copy(solved.begin(), solved.end(), state);
+        errors_[c] = error;
+        steps_[c] = step;
+    }
+}
+
+
+//=============================================================================
@@ -0,0 +1,63 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef KINEMATICS_BATCH_H
+#define KINEMATICS_BATCH_H
+//=============================================================================
+
+#include <vector>
+#include "glmath.h"
+#include "kinematics.h"
+
+//=============================================================================
+
+/// Solves many independent copies of one kinematic chain, one target each,
+/// spread over all cores with OpenMP. Every thread works on its own copy of
+/// the prototype chain, so the solver scratch buffers are reused from chain
+/// to chain. The solver history is not: a worker starts every chain like a
+/// fresh copy of the prototype, so the results do not depend on the schedule.
+class Kinematics_batch
+{
+public:
+    /// _prototype provides the chain layout and solver settings of every chain
+    Kinematics_batch(const Kinematics& _prototype);
+
+    /// runs up to _max_steps solver steps for every target.
+    /// _states holds state_size() floats per chain, back to back. If it already has
+    /// that size it is used as the initial states, otherwise every chain starts
+    /// from the prototype state. The solved states are written back into it.
+    void solve(const std::vector<vec4>& _targets, std::vector<float>& _states, unsigned int _max_steps);
+
+    /// distance of every end effector to its target after the last solve()
+    const std::vector<float>& errors() const { return errors_; }
+
+    /// number of solver steps every chain took in the last solve()
+    const std::vector<unsigned int>& steps() const { return steps_; }
+
+    /// number of DOFs of one chain
+    size_t n_dofs() const { return prototype_.n_dofs(); }
+
+    /// number of floats of the state of one chain
+    size_t state_size() const { return prototype_.state_size(); }
+
+    /// end effector distance below which a chain counts as solved
+    void set_tolerance(float _tolerance) { tolerance_ = _tolerance; }
+
+private:
+    Kinematics prototype_;
+
+    /// one copy of the prototype per thread
+    std::vector<Kinematics> workers_;
+
+    std::vector<float> errors_;
+    std::vector<unsigned int> steps_;
+
+    float tolerance_ = 1e-3f;
+};
+
+
+//=============================================================================
+#endif // KINEMATICS_BATCH_H
+//=============================================================================
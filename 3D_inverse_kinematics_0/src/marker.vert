@@ -0,0 +1,28 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#version 140
+#extension GL_ARB_explicit_attrib_location : enable
+
+layout (location = 0) in vec4 v_position;
+// per instance: position and scale, color
+layout (location = 3) in vec4 i_position_scale;
+layout (location = 4) in vec3 i_color;
+
+// the same for all objects of a frame, see scene_uniforms.h
+layout (std140) uniform Scene_uniforms {
+    mat4 projection_matrix;
+    mat4 view_matrix;
+    vec4 light_position;
+    int  greyscale;
+};
+
+flat out vec3 v2f_color;
+
+void main() {
+    v2f_color = i_color;
+    gl_Position = projection_matrix * view_matrix * vec4(i_position_scale.w * v_position.xyz + i_position_scale.xyz, 1.0);
+}
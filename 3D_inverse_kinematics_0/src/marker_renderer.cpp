@@ -0,0 +1,124 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include "marker_renderer.h"
+#include <cstddef>
+
+
+//=============================================================================
+
+
+Marker_renderer::~Marker_renderer()
+{
+    if (instance_bo_) glDeleteBuffers(1, &instance_bo_);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Marker_renderer::gl_setup(Mesh* _mesh, const std::shared_ptr<Shader>& _shader)
+{
+    mesh_ = _mesh;
+    shader_ = _shader;
+
+    glBindVertexArray(mesh_->vertex_array());
+
+    if (!instance_bo_) glGenBuffers(1, &instance_bo_);
+    glBindBuffer(GL_ARRAY_BUFFER, instance_bo_);
+
+    // the attributes advance once per instance instead of once per vertex. Core since
+    // OpenGL 3.3, the 3.2 context gets it from ARB_instanced_arrays
+    const GLsizei stride = sizeof(Instance);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, position_scale_));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, color_));
+    glEnableVertexAttribArray(4);
+    if (glVertexAttribDivisor) {
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+    }
+    else {
+        glVertexAttribDivisorARB(3, 1);
+        glVertexAttribDivisorARB(4, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // the buffer has to be filled again
+    capacity_ = 0;
+    dirty_ = true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Marker_renderer::clear()
+{
+    instances_.clear();
+    dirty_ = true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Marker_renderer::add(const vec3& _position, float _scale, const vec3& _color)
+{
+    Instance instance;
+    instance.position_scale_[0] = _position[0];
+    instance.position_scale_[1] = _position[1];
+    instance.position_scale_[2] = _position[2];
+    instance.position_scale_[3] = _scale;
+    instance.color_[0] = _color[0];
+    instance.color_[1] = _color[1];
+    instance.color_[2] = _color[2];
+    instances_.push_back(instance);
+    dirty_ = true;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Marker_renderer::add(const std::vector<vec4>& _positions, float _scale, const vec3& _color)
+{
+    instances_.reserve(instances_.size() + _positions.size());
+    for (const vec4& p : _positions) {
+        add(vec3(p), _scale, _color);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Marker_renderer::draw()
+{
+    if (!mesh_ || instances_.empty()) return;
+
+    // the buffer is only reallocated when it has to grow
+    if (dirty_) {
+        glBindBuffer(GL_ARRAY_BUFFER, instance_bo_);
+        if (instances_.size() > capacity_) {
+            glBufferData(GL_ARRAY_BUFFER, instances_.size() * sizeof(Instance), instances_.data(), GL_DYNAMIC_DRAW);
+            capacity_ = instances_.size();
+        }
+        else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instances_.size() * sizeof(Instance), instances_.data());
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        dirty_ = false;
+    }
+
+    shader_->use();
+    mesh_->draw_instanced((GLsizei)instances_.size());
+}
+
+
+//=============================================================================
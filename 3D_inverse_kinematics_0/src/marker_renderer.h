@@ -0,0 +1,69 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef MARKER_RENDERER_H
+#define MARKER_RENDERER_H
+//=============================================================================
+
+#include <vector>
+#include "gl.h"
+#include "glmath.h"
+#include "shader.h"
+#include "mesh/mesh.h"
+#include "scene_uniforms.h"
+
+//=============================================================================
+
+/// draws many small markers, e.g. the targets along a path, as instances of one
+/// mesh. Position, scale and color of every marker go to one instance buffer and
+/// all markers are drawn with a single instanced draw call, instead of a shader
+/// switch, the uniform uploads and a draw call per marker.
+class Marker_renderer
+{
+public:
+    ~Marker_renderer();
+
+    /// markers are instances of _mesh, drawn with _shader (marker.vert, marker.frag)
+    /// whose Scene_uniforms block has to be bound. The renderer adds the instance attributes to the vertex array of _mesh,
+    /// so the mesh should not be shared with non-instanced objects
+    void gl_setup(Mesh* _mesh, const std::shared_ptr<Shader>& _shader);
+
+    /// removes all markers
+    void clear();
+
+    void add(const vec3& _position, float _scale, const vec3& _color);
+
+    /// one marker at each of the _positions
+    void add(const std::vector<vec4>& _positions, float _scale, const vec3& _color);
+
+    size_t size() const { return instances_.size(); }
+
+    /// uploads the markers if they changed and draws all of them with the
+    /// projection and view of the Scene_uniforms
+    void draw();
+
+private:
+    /// per instance attributes, location 3: position and scale, location 4: color
+    struct Instance
+    {
+        float position_scale_[4];
+        float color_[3];
+    };
+
+    std::vector<Instance> instances_;
+    bool dirty_ = false;
+
+    Mesh* mesh_ = nullptr;
+    std::shared_ptr<Shader> shader_;
+
+    /// instance buffer object and the number of instances it has room for
+    GLuint instance_bo_ = 0;
+    size_t capacity_ = 0;
+};
+
+
+//=============================================================================
+#endif // MARKER_RENDERER_H
+//=============================================================================
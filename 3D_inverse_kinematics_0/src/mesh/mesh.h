@@ -10,8 +10,20 @@ class Mesh
 {
 public:
     /// render mesh of the Mesh
-    virtual void draw(GLenum mode=GL_TRIANGLES) = 0
-    {}
+    virtual void draw(GLenum mode=GL_TRIANGLES) = 0;
+
+    /// render _instances copies of the mesh with one draw call, the per instance
+    /// attributes have to be added to vertex_array() from location 3 on
+    virtual void draw_instanced(GLsizei _instances, GLenum mode=GL_TRIANGLES) = 0;
+
+    /// vertex array object of the mesh, generated on first use
+    virtual GLuint vertex_array() = 0;
+
+    /// binds the vertex array for draw_bound(), which can then be called repeatedly
+    void bind() { glBindVertexArray(vertex_array()); }
+
+    /// render the mesh with its vertex array bound by bind(), leaves it bound
+    virtual void draw_bound(GLenum mode=GL_TRIANGLES) = 0;
 };
 
 
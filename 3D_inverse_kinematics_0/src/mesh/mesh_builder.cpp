@@ -0,0 +1,344 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include "mesh/mesh_builder.h"
+#include <cassert>
+#include <cstring>
+#include <math.h>
+
+//=============================================================================
+
+
+/// IEEE half float of _f, rounded to nearest. Small values become denormals or
+/// zero, values beyond the half range infinity
+static uint16_t float_to_half(float _f)
+{
+    uint32_t x;
+    memcpy(&x, &_f, sizeof(x));
+
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const int exponent = (int)((x >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = x & 0x7fffff;
+
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7c00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (uint16_t)sign;
+        }
+        // denormal, the implicit leading one becomes explicit
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) half++;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    // a carry out of the mantissa correctly increments the exponent
+    if (mantissa & 0x1000) half++;
+    return (uint16_t)half;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Mesh_builder Mesh_builder::sphere(unsigned int _resolution)
+{
+    const unsigned int v_resolution =     _resolution;
+    const unsigned int u_resolution = 2 * _resolution;
+
+    Mesh_builder mesh;
+    for (unsigned int iv = 0; iv < v_resolution; ++iv)
+    {
+        for (unsigned int iu = 0; iu < u_resolution; ++iu)
+        {
+            float u = (float) iu / (float) (u_resolution - 1);
+            float v = (float) iv / (float) (v_resolution - 1);
+
+            float theta = u * 2.0f * (float) M_PI;
+            float phi   = v * (float) M_PI;
+
+            vec3 p(cos(theta) * sin(phi), sin(theta) * sin(phi), cos(phi));
+            mesh.add_vertex(p, p, 1.0f - u, 1.0f - v);
+        }
+    }
+    mesh.add_grid_triangles(u_resolution, v_resolution);
+    return mesh;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+Mesh_builder Mesh_builder::cylinder(unsigned int _resolution)
+{
+    const unsigned int v_resolution = 2;
+    const unsigned int u_resolution = _resolution;
+
+    Mesh_builder mesh;
+    for (unsigned int iv = 0; iv < v_resolution; ++iv)
+    {
+        for (unsigned int iu = 0; iu < u_resolution; ++iu)
+        {
+            float u = (float) iu / (float) (u_resolution - 1);
+            float v = (float) iv / (float) (v_resolution - 1);
+
+            float theta = u * 2.0f * (float) M_PI;
+
+            vec3 p(cos(theta), sin(theta), v);
+            mesh.add_vertex(p, p, 1.0f - u, 1.0f - v);
+        }
+    }
+    mesh.add_grid_triangles(u_resolution, v_resolution);
+    return mesh;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Mesh_builder::add_grid_triangles(unsigned int _u_resolution, unsigned int _v_resolution)
+{
+    for (unsigned int v = 0; v < _v_resolution - 1; ++v)
+    {
+        for (unsigned int u = 0; u < _u_resolution - 1; ++u)
+        {
+            unsigned int i0 = (u  ) + (v  ) * _u_resolution;
+            unsigned int i1 = (u+1) + (v  ) * _u_resolution;
+            unsigned int i2 = (u+1) + (v+1) * _u_resolution;
+            unsigned int i3 = (u  ) + (v+1) * _u_resolution;
+
+            add_triangle(i0, i1, i2);
+            add_triangle(i0, i2, i3);
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+unsigned int Mesh_builder::add_vertex(const vec3& _position, const vec3& _normal, float _u, float _v)
+{
+    positions_.push_back(_position);
+    normals_.push_back(_normal);
+    texcoords_.push_back(_u);
+    texcoords_.push_back(_v);
+    return (unsigned int)positions_.size() - 1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Mesh_builder::add_triangle(unsigned int _i0, unsigned int _i1, unsigned int _i2)
+{
+    indices_.push_back(_i0);
+    indices_.push_back(_i1);
+    indices_.push_back(_i2);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Mesh_builder::optimize_vertex_cache(unsigned int _cache_size)
+{
+    const size_t n_vertices = positions_.size();
+    const size_t n_triangles = indices_.size() / 3;
+    if (n_triangles == 0) return;
+    assert(_cache_size > 3);
+
+    // the score of a vertex: high if it was used recently, and if few triangles are
+    // left that use it, so vertices are finished instead of leaving isolated triangles
+    const unsigned int cache_size = _cache_size;
+    std::vector<float> cache_score(cache_size);
+    for (unsigned int i = 0; i < cache_size; i++) {
+        cache_score[i] = i < 3 ? 0.75f : powf(1.0f - (float)(i - 3) / (cache_size - 3), 1.5f);
+    }
+
+    // the triangles of every vertex, the first remaining_[v] of them are not emitted yet
+    std::vector<unsigned int> remaining(n_vertices, 0);
+    for (unsigned int i : indices_) remaining[i]++;
+    std::vector<unsigned int> offsets(n_vertices + 1, 0);
+    for (size_t v = 0; v < n_vertices; v++) offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> vertex_triangles(indices_.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < n_triangles; t++) {
+        for (int k = 0; k < 3; k++) vertex_triangles[fill[indices_[3 * t + k]]++] = (unsigned int)t;
+    }
+
+    std::vector<int> cache_position(n_vertices, -1);
+    std::vector<float> vertex_score(n_vertices);
+    auto score = [&](size_t _v) -> float {
+        if (remaining[_v] == 0) return -1.0f;
+        float s = 2.0f / sqrtf((float)remaining[_v]);
+        if (cache_position[_v] >= 0) s += cache_score[cache_position[_v]];
+        return s;
+    };
+    for (size_t v = 0; v < n_vertices; v++) vertex_score[v] = score(v);
+
+    std::vector<float> triangle_score(n_triangles);
+    std::vector<bool> emitted(n_triangles, false);
+    for (size_t t = 0; t < n_triangles; t++) {
+        triangle_score[t] = vertex_score[indices_[3 * t]] + vertex_score[indices_[3 * t + 1]] + vertex_score[indices_[3 * t + 2]];
+    }
+
+    std::vector<unsigned int> cache, next_cache;
+    cache.reserve(cache_size + 3);
+    next_cache.reserve(cache_size + 3);
+    std::vector<unsigned int> order;
+    order.reserve(indices_.size());
+
+    size_t best = 0;
+    for (size_t t = 1; t < n_triangles; t++) {
+        if (triangle_score[t] > triangle_score[best]) best = t;
+    }
+    size_t scan = 0;
+
+    for (size_t emitted_count = 0; emitted_count < n_triangles; emitted_count++)
+    {
+        const unsigned int* tri = &indices_[3 * best];
+        emitted[best] = true;
+        order.insert(order.end(), tri, tri + 3);
+
+        // remove the triangle from the lists of its vertices
+        for (int k = 0; k < 3; k++) {
+            const unsigned int v = tri[k];
+            unsigned int* list = &vertex_triangles[offsets[v]];
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                if (list[j] == best) {
+                    std::swap(list[j], list[remaining[v] - 1]);
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // the triangle's vertices move to the front of the LRU cache
+        next_cache.assign(tri, tri + 3);
+        for (unsigned int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) next_cache.push_back(v);
+        }
+        cache.swap(next_cache);
+
+        // rescore the vertices in the cache and the ones that just dropped out of it,
+        // and their remaining triangles; the best of those is the next triangle
+        for (size_t i = 0; i < cache.size(); i++) {
+            cache_position[cache[i]] = i < cache_size ? (int)i : -1;
+        }
+        for (unsigned int v : cache) {
+            vertex_score[v] = score(v);
+        }
+        if (cache.size() > cache_size) cache.resize(cache_size);
+
+        float best_score = -1.0f;
+        for (unsigned int v : cache) {
+            for (unsigned int j = 0; j < remaining[v]; j++) {
+                const unsigned int t = vertex_triangles[offsets[v] + j];
+                triangle_score[t] = vertex_score[indices_[3 * t]] + vertex_score[indices_[3 * t + 1]] + vertex_score[indices_[3 * t + 2]];
+                if (triangle_score[t] > best_score) {
+                    best_score = triangle_score[t];
+                    best = t;
+                }
+            }
+        }
+
+        // nothing left around the cache, continue with the next unused triangle
+        if (best_score < 0.0f) {
+            while (scan < n_triangles && emitted[scan]) scan++;
+            best = scan;
+        }
+    }
+
+    // number the vertices in the order of their first use
+    std::vector<unsigned int> remap(n_vertices, (unsigned int)-1);
+    unsigned int next = 0;
+    for (unsigned int& i : order) {
+        if (remap[i] == (unsigned int)-1) remap[i] = next++;
+        i = remap[i];
+    }
+    std::vector<vec3> positions(next), normals(next);
+    std::vector<float> texcoords(2 * next);
+    for (size_t v = 0; v < n_vertices; v++) {
+        if (remap[v] == (unsigned int)-1) continue;
+        positions[remap[v]] = positions_[v];
+        normals[remap[v]] = normals_[v];
+        texcoords[2 * remap[v]] = texcoords_[2 * v];
+        texcoords[2 * remap[v] + 1] = texcoords_[2 * v + 1];
+    }
+    positions_.swap(positions);
+    normals_.swap(normals);
+    texcoords_.swap(texcoords);
+    indices_.swap(order);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+double Mesh_builder::acmr(unsigned int _cache_size) const
+{
+    if (indices_.empty()) return 0.0;
+
+    // a vertex is in the FIFO if fewer than _cache_size misses happened since it was
+    // loaded, loaded[i] is the miss that loaded it, 0 for never
+    std::vector<size_t> loaded(positions_.size(), 0);
+    size_t misses = 0;
+    for (unsigned int i : indices_) {
+        if (loaded[i] == 0 || misses - loaded[i] >= _cache_size) {
+            misses++;
+            loaded[i] = misses;
+        }
+    }
+    return (double)misses / (indices_.size() / 3);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Mesh_builder::pack(vertex_format_t _format)
+{
+    format_ = _format;
+    const size_t n = positions_.size();
+    const unsigned int stride_bytes = stride();
+
+    vertex_data_.assign(n * stride_bytes, 0);
+    for (size_t v = 0; v < n; v++) {
+        uint8_t* out = &vertex_data_[v * stride_bytes];
+        memcpy(out, positions_[v].data(), 3 * sizeof(float));
+        if (format_ == HALF_VERTICES) {
+            // the fourth half of the normal is padding, attributes start at multiples of 4
+            const uint16_t normal[4] = {float_to_half(normals_[v][0]), float_to_half(normals_[v][1]), float_to_half(normals_[v][2]), 0};
+            const uint16_t texcoord[2] = {float_to_half(texcoords_[2 * v]), float_to_half(texcoords_[2 * v + 1])};
+            memcpy(out + normal_offset(), normal, sizeof(normal));
+            memcpy(out + texcoord_offset(), texcoord, sizeof(texcoord));
+        }
+        else {
+            memcpy(out + normal_offset(), normals_[v].data(), 3 * sizeof(float));
+            memcpy(out + texcoord_offset(), &texcoords_[2 * v], 2 * sizeof(float));
+        }
+    }
+
+    const unsigned int index_bytes = index_size();
+    index_data_.resize(indices_.size() * index_bytes);
+    for (size_t i = 0; i < indices_.size(); i++) {
+        if (index_bytes == 2) {
+            const uint16_t index = (uint16_t)indices_[i];
+            memcpy(&index_data_[2 * i], &index, 2);
+        }
+        else {
+            memcpy(&index_data_[4 * i], &indices_[i], 4);
+        }
+    }
+}
+
+
+//=============================================================================
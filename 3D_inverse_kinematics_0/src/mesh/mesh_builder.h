@@ -0,0 +1,91 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+//=============================================================================
+
+#include <stdint.h>
+#include <vector>
+#include "glmath.h"
+
+//=============================================================================
+
+/// storage of the normals and texture coordinates in the vertex buffer
+enum vertex_format_t {
+    /// position, normal and texture coordinate as floats, 32 bytes per vertex
+    FLOAT_VERTICES,
+    /// float position, half float normal (padded to 8 bytes) and texture coordinate,
+    /// 24 bytes per vertex. The shaders still read vec3 and vec2
+    HALF_VERTICES
+};
+
+/// collects the vertices and triangles of a mesh and packs them for the GPU: one
+/// interleaved vertex buffer (position at offset 0, normal, texture coordinate) and
+/// an index buffer with 16 bit indices whenever the vertices fit. GL-free, the
+/// meshes upload vertex_data() and index_data() as they are.
+class Mesh_builder
+{
+public:
+    /// unit sphere around the origin, _resolution rings of 2 _resolution vertices
+    static Mesh_builder sphere(unsigned int _resolution);
+
+    /// cylinder of radius 1 around the z axis from z = 0 to z = 1, _resolution vertices per rim
+    static Mesh_builder cylinder(unsigned int _resolution);
+
+    /// returns the index of the new vertex
+    unsigned int add_vertex(const vec3& _position, const vec3& _normal, float _u, float _v);
+
+    void add_triangle(unsigned int _i0, unsigned int _i1, unsigned int _i2);
+
+    size_t n_vertices() const { return positions_.size(); }
+    size_t n_indices() const { return indices_.size(); }
+
+    const std::vector<unsigned int>& indices() const { return indices_; }
+
+    /// reorders the triangles for the post-transform vertex cache (Forsyth's linear
+    /// speed algorithm, simulating an LRU cache of _cache_size entries), then the
+    /// vertices in the order the triangles first use them, for the pre-transform fetch
+    void optimize_vertex_cache(unsigned int _cache_size = 32);
+
+    /// average cache miss ratio, transformed vertices per triangle, of the current
+    /// triangle order in a FIFO cache of _cache_size entries. 3 is the worst, 0.5 about the best
+    double acmr(unsigned int _cache_size) const;
+
+    /// packs the vertices into one interleaved buffer and the indices into 16 or 32 bits
+    void pack(vertex_format_t _format);
+
+    /// the packed buffers of the last pack()
+    const std::vector<uint8_t>& vertex_data() const { return vertex_data_; }
+    const std::vector<uint8_t>& index_data() const { return index_data_; }
+
+    vertex_format_t format() const { return format_; }
+
+    /// bytes per vertex and the offsets of the normal and the texture coordinate
+    unsigned int stride() const { return format_ == HALF_VERTICES ? 24 : 32; }
+    unsigned int normal_offset() const { return 12; }
+    unsigned int texcoord_offset() const { return format_ == HALF_VERTICES ? 20 : 24; }
+
+    /// 2 for 16 bit indices, 4 for 32 bit indices
+    unsigned int index_size() const { return n_vertices() <= 0xffff ? 2 : 4; }
+
+private:
+    /// vertices of a (_u_resolution x _v_resolution) grid and its two triangles per cell
+    void add_grid_triangles(unsigned int _u_resolution, unsigned int _v_resolution);
+
+    std::vector<vec3> positions_;
+    std::vector<vec3> normals_;
+    std::vector<float> texcoords_;
+    std::vector<unsigned int> indices_;
+
+    vertex_format_t format_ = FLOAT_VERTICES;
+    std::vector<uint8_t> vertex_data_;
+    std::vector<uint8_t> index_data_;
+};
+
+
+//=============================================================================
+#endif // MESH_BUILDER_H
+//=============================================================================
@@ -0,0 +1,105 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include "mesh/packed_mesh.h"
+
+//=============================================================================
+
+
+Packed_mesh::~Packed_mesh()
+{
+    if (vbo_)  glDeleteBuffers(1, &vbo_);
+    if (ibo_)  glDeleteBuffers(1, &ibo_);
+    if (vao_)  glDeleteVertexArrays(1, &vao_);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Packed_mesh::initialize()
+{
+    Mesh_builder mesh = build();
+    mesh.optimize_vertex_cache();
+    mesh.pack(format_);
+
+    n_indices_ = (unsigned int)mesh.n_indices();
+    index_type_ = mesh.index_size() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    // generate vertex array object
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+
+    // one interleaved buffer: positions -> attribute 0, normals -> attribute 1,
+    // texture coordinates -> attribute 2
+    const GLenum type = mesh.format() == HALF_VERTICES ? GL_HALF_FLOAT : GL_FLOAT;
+    const GLsizei stride = mesh.stride();
+    glGenBuffers(1, &vbo_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertex_data().size(), mesh.vertex_data().data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, type, GL_FALSE, stride, (void*)(size_t)mesh.normal_offset());
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, type, GL_FALSE, stride, (void*)(size_t)mesh.texcoord_offset());
+    glEnableVertexAttribArray(2);
+
+    // triangle indices
+    glGenBuffers(1, &ibo_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.index_data().size(), mesh.index_data().data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Packed_mesh::draw(GLenum mode)
+{
+    if (n_indices_ == 0) initialize();
+
+    glBindVertexArray(vao_);
+    glDrawElements(mode, n_indices_, index_type_, NULL);
+    glBindVertexArray(0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Packed_mesh::draw_instanced(GLsizei _instances, GLenum mode)
+{
+    if (n_indices_ == 0) initialize();
+
+    glBindVertexArray(vao_);
+    glDrawElementsInstanced(mode, n_indices_, index_type_, NULL, _instances);
+    glBindVertexArray(0);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+GLuint Packed_mesh::vertex_array()
+{
+    if (n_indices_ == 0) initialize();
+    return vao_;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Packed_mesh::draw_bound(GLenum mode)
+{
+    glDrawElements(mode, n_indices_, index_type_, NULL);
+}
+
+
+//=============================================================================
@@ -0,0 +1,67 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef PACKED_MESH_H
+#define PACKED_MESH_H
+//=============================================================================
+
+#include "gl.h"
+#include "mesh/mesh.h"
+#include "mesh/mesh_builder.h"
+
+//=============================================================================
+
+/// mesh in one interleaved vertex buffer and one index buffer, built by a
+/// Mesh_builder on first use: triangles in vertex cache order, 16 bit indices when
+/// the vertices fit. Position, normal and texture coordinate stay at the attribute
+/// locations 0, 1 and 2, whatever their format.
+class Packed_mesh : public Mesh
+{
+public:
+    Packed_mesh(vertex_format_t _format = HALF_VERTICES) :
+        format_(_format)
+    {}
+
+    virtual ~Packed_mesh();
+
+    /// render the mesh
+    void draw(GLenum mode=GL_TRIANGLES);
+
+    /// render _instances copies of the mesh with one draw call
+    void draw_instanced(GLsizei _instances, GLenum mode=GL_TRIANGLES);
+
+    /// vertex array object of the mesh, generated on first use
+    GLuint vertex_array();
+
+    /// render the mesh with its vertex array bound by bind()
+    void draw_bound(GLenum mode=GL_TRIANGLES);
+
+protected:
+    /// vertices and triangles of the mesh
+    virtual Mesh_builder build() const = 0;
+
+private:
+    /// builds, optimizes and packs the mesh and uploads it
+    void initialize();
+
+private:
+    vertex_format_t format_;
+
+    /// indices of the triangle vertices
+    unsigned int n_indices_ = 0;
+    /// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum index_type_ = GL_UNSIGNED_INT;
+
+    /// vertex array object
+    GLuint vao_ = 0;
+    /// interleaved vertex buffer object
+    GLuint vbo_ = 0;
+    /// index buffer object
+    GLuint ibo_ = 0;
+};
+
+//=============================================================================
+#endif // PACKED_MESH_H
+//=============================================================================
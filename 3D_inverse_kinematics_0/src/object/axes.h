@@ -9,6 +9,7 @@
 
 #include "texture.h"
 #include "gl_context.h"
+#include "render_queue.h"
 #include "glmath.h"
 
 //=============================================================================
@@ -21,7 +22,7 @@ public:
     float scale_;
     float height_;
     Mesh* mesh_;
-    Shader shader_;
+    std::shared_ptr<Shader> shader_;
 
 public:
     /// default constructor
@@ -38,7 +39,7 @@ public:
 
     void gl_setup(GL_Context& ctx)
     {
-        shader_ = *(ctx.solid_color_shader);
+        shader_ = ctx.solid_color_shader;
         mesh_ = ctx.unit_cylinder;
     }
 
@@ -50,28 +51,20 @@ public:
     }
 
 
-    void draw(mat4& _projection, mat4& _view)
+    void submit(Render_queue& _queue)
     {
-        draw_cylinder(_projection, _view, base_location_, base_orientation_ * mat4::rotate_y( 90.0f), vec3(1.0f, 0.0f, 0.0f));
-        draw_cylinder(_projection, _view, base_location_, base_orientation_ * mat4::rotate_x(-90.0f), vec3(0.0f, 1.0f, 0.0f));
-        draw_cylinder(_projection, _view, base_location_, base_orientation_                         , vec3(0.0f, 0.0f, 1.0f));
+        submit_cylinder(_queue, base_orientation_ * mat4::rotate_y( 90.0f), vec3(1.0f, 0.0f, 0.0f));
+        submit_cylinder(_queue, base_orientation_ * mat4::rotate_x(-90.0f), vec3(0.0f, 1.0f, 0.0f));
+        submit_cylinder(_queue, base_orientation_                         , vec3(0.0f, 0.0f, 1.0f));
     }
 
 
-    void draw_cylinder(mat4& _projection, mat4& _view, vec4 _base_location, mat4 _base_orientation, vec3 _color)
+    void submit_cylinder(Render_queue& _queue, mat4 _orientation, vec3 _color)
     {
         mat4 scaling = mat4::scale(scale_, scale_, height_);
-        mat4 translation = mat4::translate(vec3(_base_location));
-        
-        mat4 m_matrix = translation * _base_orientation * scaling;
-        mat4 mv_matrix = _view * m_matrix;
-        mat4 mvp_matrix = _projection * mv_matrix;
-
-        shader_.use();
-        shader_.set_uniform("color", _color);
-        shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-        
-        mesh_->draw();
+        mat4 translation = mat4::translate(vec3(base_location_));
+
+        _queue.add(shader_.get(), NULL, mesh_, translation * _orientation * scaling, _color);
     }
 
 };
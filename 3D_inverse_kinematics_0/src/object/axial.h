@@ -31,14 +31,19 @@ public:
 
     void gl_setup(GL_Context& ctx)
     {
-        shader_ = *(ctx.phong_shader);
+        shader_ = ctx.phong_shader;
         mesh_ = ctx.unit_sphere;
         tex_ = ctx.pluto;
         axes_.gl_setup(ctx);
     }
 
+    /// base frame turned around its z axis, like Axial_joint
+    Rigid_transform end_frame() const {
+        return base_frame().rotated_z(rot_angle_);
+    }
+
     mat4 end_orientation() {
-        return base_orientation_ * mat4::rotate_z(rot_angle_);
+        return mat4(end_frame().rotation_);
     }
 
     /// set the time for every update
@@ -47,45 +52,18 @@ public:
         rot_angle_ += 0.1f;
     }
 
-    void update_dof(std::vector<float> values)
+    void update_dof(Span<const float> values)
     {
-        rot_angle_ = values.at(0);
-    }
-
-    std::pair<vec4, mat4> forward(std::pair<vec4, mat4> _prev_coordinates, std::vector<float> _state) {
-        assert(!_state.empty());
-        return std::pair<vec4, mat4>(_prev_coordinates.first,
-                                     _prev_coordinates.second * mat4::rotate_z(_state.at(0)));
+        rot_angle_ = values[0];
     }
 
-    void draw(mat4& _projection, mat4& _view, Object& _light, bool _greyscale)
+    void submit(Render_queue& _queue)
     {
-        // assume proper dimensions of the object
-        mat4 scaling = mat4::scale(scale_);
-
-        // Put the object to its proper world coordinates
-        mat4 translation = mat4::translate(vec3(base_location_));
-
-        mat4 m_matrix = translation * end_orientation() * scaling;
-        mat4 mv_matrix = _view * m_matrix;
-        mat4 mvp_matrix = _projection * mv_matrix;
-        mat3 n_matrix = transpose(inverse(mat3(mv_matrix)));
-
-        shader_.use();
-        shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-        shader_.set_uniform("modelview_matrix", mv_matrix);
-        shader_.set_uniform("normal_matrix", n_matrix);
-        shader_.set_uniform("t", 0.0f, true /* Indicate that time parameter is optional;
-                                                                it may be optimized away by the GLSL    compiler if it's unused. */);
-        shader_.set_uniform("light_position", _view * _light.base_location_);
-        shader_.set_uniform("tex", 0);
-        shader_.set_uniform("greyscale", (int)_greyscale);
-        
-        tex_->bind();
-        mesh_->draw();
+        // scale the unit sphere and put it to its proper world coordinates
+        _queue.add(shader_.get(), tex_, mesh_, end_frame().to_mat4(vec3(scale_)));
 
         if (enable_axes_) {
-            axes_.draw(_projection, _view);
+            axes_.submit(_queue);
         }
     }
 
@@ -33,7 +33,7 @@ public:
 
     void gl_setup(GL_Context& ctx)
     {
-        shader_ = *(ctx.phong_shader);
+        shader_ = ctx.phong_shader;
         mesh_ = ctx.unit_cylinder;
         tex_ = ctx.day;
         axes_.gl_setup(ctx);
@@ -44,37 +44,12 @@ public:
         return base_location_ + height_ * axis;
     }
 
-    std::pair<vec4, mat4> forward(std::pair<vec4, mat4> _prev_coordinates, std::vector<float> _state) {
-        return std::pair<vec4, mat4>(mat4::translate(height_ * _prev_coordinates.second.base_z()) * _prev_coordinates.first,
-                                     _prev_coordinates.second);
-    }
-
-    void draw(mat4& _projection, mat4& _view, Object& _light, bool _greyscale)
+    void submit(Render_queue& _queue)
     {
-        // the matrices we need: model, modelview, modelview-projection, normal
-        mat4 scaling = mat4::scale(scale_, scale_, height_);
-        mat4 translation = mat4::translate(vec3(base_location_));
-        
-        mat4 m_matrix = translation * base_orientation_ * scaling;
-        mat4 mv_matrix = _view * m_matrix;
-        mat4 mvp_matrix = _projection * mv_matrix;
-        mat3 n_matrix = transpose(inverse(mat3(mv_matrix)));
-
-        shader_.use();
-        shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-        shader_.set_uniform("modelview_matrix", mv_matrix);
-        shader_.set_uniform("normal_matrix", n_matrix);
-        shader_.set_uniform("t", 0.0f, true /* Indicate that time parameter is optional;
-                                                                it may be optimized away by the GLSL    compiler if it's unused. */);
-        shader_.set_uniform("light_position", _view * _light.base_location_);
-        shader_.set_uniform("tex", 0);
-        shader_.set_uniform("greyscale", (int)_greyscale);
-        
-        tex_->bind();
-        mesh_->draw();
+        _queue.add(shader_.get(), tex_, mesh_, base_frame().to_mat4(vec3(scale_, scale_, height_)));
 
         if (enable_axes_) {
-            axes_.draw(_projection, _view);
+            axes_.submit(_queue);
         }
     }
 };
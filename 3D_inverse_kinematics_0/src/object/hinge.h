@@ -34,14 +34,19 @@ public:
 
     void gl_setup(GL_Context& ctx)
     {
-        shader_ = *(ctx.phong_shader);
+        shader_ = ctx.phong_shader;
         mesh_ = ctx.unit_cylinder;
         tex_ = ctx.moon;
         axes_.gl_setup(ctx);
     }
 
+    /// base frame turned around its x axis, like Hinge_joint
+    Rigid_transform end_frame() const {
+        return base_frame().rotated_x(rot_angle_);
+    }
+
     mat4 end_orientation() {
-        return base_orientation_ * mat4::rotate_x(rot_angle_);
+        return mat4(end_frame().rotation_);
     }
 
     /// set the time for every update
@@ -50,47 +55,21 @@ public:
         rot_angle_ += 0.1f;
     }
 
-    void update_dof(std::vector<float> values)
+    void update_dof(Span<const float> values)
     {
-        rot_angle_ = values.at(0);
+        rot_angle_ = values[0];
     }
 
-    std::pair<vec4, mat4> forward(std::pair<vec4, mat4> _prev_coordinates, std::vector<float> _state) {
-        assert(!_state.empty());
-        return std::pair<vec4, mat4>(_prev_coordinates.first,
-                                     _prev_coordinates.second * mat4::rotate_x(_state.at(0)));
-    }
-
-    void draw(mat4& _projection, mat4& _view, Object& _light, bool _greyscale)
+    void submit(Render_queue& _queue)
     {
-        // assume proper dimensions of the object
-        mat4 scaling = mat4::scale(scale_, scale_, height_);
         // orient the cylinder perpendicular along the rotation axis
-        mat4 hinge_orientation = mat4::translate(-vec3(0.5f * height_, 0.0f, 0.0f)) * mat4::rotate_y(90.0f);
-
-        // Put the object to its proper world coordinates
-        mat4 translation = mat4::translate(vec3(base_location_));
-
-        mat4 m_matrix = translation * end_orientation() * hinge_orientation * scaling;
-        mat4 mv_matrix = _view * m_matrix;
-        mat4 mvp_matrix = _projection * mv_matrix;
-        mat3 n_matrix = transpose(inverse(mat3(mv_matrix)));
-
-        shader_.use();
-        shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-        shader_.set_uniform("modelview_matrix", mv_matrix);
-        shader_.set_uniform("normal_matrix", n_matrix);
-        shader_.set_uniform("t", 0.0f, true /* Indicate that time parameter is optional;
-                                                                it may be optimized away by the GLSL    compiler if it's unused. */);
-        shader_.set_uniform("light_position", _view * _light.base_location_);
-        shader_.set_uniform("tex", 0);
-        shader_.set_uniform("greyscale", (int)_greyscale);
-        
-        tex_->bind();
-        mesh_->draw();
+        Rigid_transform hinge_orientation = Rigid_transform::translate(-vec3(0.5f * height_, 0.0f, 0.0f)) * Rigid_transform::rotate_y(90.0f);
+
+        // scale the unit cylinder and put it to its proper world coordinates
+        _queue.add(shader_.get(), tex_, mesh_, (end_frame() * hinge_orientation).to_mat4(vec3(scale_, scale_, height_)));
 
         if (enable_axes_) {
-            axes_.draw(_projection, _view);
+            axes_.submit(_queue);
         }
     }
 
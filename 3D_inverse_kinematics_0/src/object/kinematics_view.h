@@ -0,0 +1,113 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef KINEMATICS_VIEW_H
+#define KINEMATICS_VIEW_H
+//=============================================================================
+
+#include <vector>
+#include "gl_context.h"
+#include "glmath.h"
+#include "kinematics.h"
+#include "object.h"
+#include "bone.h"
+#include "hinge.h"
+#include "axial.h"
+#include "ball.h"
+
+//=============================================================================
+
+/// render side of a Kinematics chain, one drawable object per joint.
+/// The objects only mirror the math model, update() copies the current
+/// DOFs and joint frames into them.
+class Kinematics_view
+{
+public:
+    /// drawable objects, bodies_[i] shows joint i of the chain
+    std::vector<Object*> bodies_;
+
+private:
+    /// scratch space for the joint frames
+    std::vector<Rigid_transform> frames_;
+
+public:
+    Kinematics_view() {}
+
+    ~Kinematics_view()
+    {
+        clear();
+    }
+
+    /// creates one object per joint of _model
+    void build(const Kinematics& _model)
+    {
+        clear();
+
+        const vec4 origin(0.0f, 0.0f, 0.0f, 1.0f);
+        for (size_t i = 0; i < _model.n_joints(); i++) {
+            const Joint& joint = _model.joint(i);
+            switch (joint.type_) {
+                case HINGE_JOINT:
+                    bodies_.push_back(new Hinge(origin, mat4::identity(), 0.3f));
+                    break;
+                case AXIAL_JOINT:
+                    bodies_.push_back(new Axial(origin, mat4::identity(), 0.25f));
+                    break;
+                case BALL_JOINT:
+                    bodies_.push_back(new Ball(origin, mat4::identity(), 0.35f));
+                    break;
+                case BONE_JOINT:
+                default:
+                    bodies_.push_back(new Bone(origin, mat4::identity(), 0.15f, joint.length_));
+                    break;
+            }
+        }
+    }
+
+    void gl_setup(GL_Context& ctx)
+    {
+        for (Object* body: bodies_) {
+            body->gl_setup(ctx);
+        }
+    }
+
+    /// moves the objects to the current state of _model, returns the end effector
+    vec4 update(Kinematics& _model)
+    {
+        assert(bodies_.size() == _model.n_joints());
+
+        vec3 end_effector = _model.joint_frames(frames_).translation_;
+        for (size_t i = 0; i < bodies_.size(); i++) {
+            bodies_[i]->update_dof(_model.dofs(i));
+            bodies_[i]->update_position(vec4(frames_[i].translation_, 1.0f), mat4(frames_[i].rotation_));
+        }
+        return vec4(end_effector, 1.0f);
+    }
+
+    void submit(Render_queue& _queue)
+    {
+        for (Object* body: bodies_) {
+            body->submit(_queue);
+        }
+    }
+
+private:
+    void clear()
+    {
+        for (Object* body: bodies_) {
+            delete body;
+        }
+        bodies_.clear();
+    }
+
+    // owns the objects
+    Kinematics_view(const Kinematics_view&);
+    Kinematics_view& operator=(const Kinematics_view&);
+};
+
+
+//=============================================================================
+#endif // KINEMATICS_VIEW_H
+//=============================================================================
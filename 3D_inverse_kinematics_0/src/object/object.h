@@ -12,8 +12,11 @@
 #include "mesh/mesh.h"
 #include "shader.h"
 #include "gl_context.h"
+#include "render_queue.h"
 #include "glmath.h"
+#include "rigid_transform.h"
 #include "axes.h"
+#include "span.h"
 
 //=============================================================================
 
@@ -37,7 +40,7 @@ public:
 
     Mesh* mesh_;
 
-    Shader shader_;
+    std::shared_ptr<Shader> shader_;
     
     /// main diffuse texture for the object
     Texture* tex_;
@@ -65,14 +68,22 @@ public:
         enable_axes_(_enable_axes)
     {}
 
+    virtual ~Object()
+    {}
+
     virtual void gl_setup(GL_Context& ctx)
     {
-        shader_ = *(ctx.solid_color_shader);
+        shader_ = ctx.solid_color_shader;
         mesh_ = ctx.unit_sphere;
 
         axes_.gl_setup(ctx);
     }
 
+    /// location and orientation of the object's base as one rigid transform
+    Rigid_transform base_frame() const {
+        return Rigid_transform(mat3(base_orientation_), vec3(base_location_));
+    }
+
     virtual vec4 end_location() {
         return vec4(base_location_);
     }
@@ -84,14 +95,9 @@ public:
     virtual void time_step(float _time)
     {}
 
-    virtual void update_dof(std::vector<float> values)
+    virtual void update_dof(Span<const float> values)
     {}
 
-    virtual std::pair<vec4, mat4> forward(std::pair<vec4, mat4> _prev_coordinates, std::vector<float> _state)
-    {
-        return _prev_coordinates;
-    }
-
     virtual void update_position(const vec4 _prev_endpoint, const mat4 _prev_orientation)
     {
         base_location_ = _prev_endpoint;
@@ -104,23 +110,14 @@ public:
         axes_.update_position(end_location(), end_orientation());
     }
 
-    virtual void draw(mat4& _projection, mat4& _view, Object& _light, bool _greyscale)
+    /// adds the draw items of the object to _queue
+    virtual void submit(Render_queue& _queue)
     {
-        mat4 scaling = mat4::scale(scale_);
-        mat4 translation = mat4::translate(vec3(base_location_));
-        
-        mat4 m_matrix = translation * scaling;
-        mat4 mv_matrix = _view * m_matrix;
-        mat4 mvp_matrix = _projection * mv_matrix;
-
-        shader_.use();
-        shader_.set_uniform("color", color_);
-        shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-        
-        mesh_->draw();
+        mat4 m_matrix = mat4::translate(vec3(base_location_)) * mat4::scale(scale_);
+        _queue.add(shader_.get(), NULL, mesh_, m_matrix, color_);
 
         if (enable_axes_) {
-            axes_.draw(_projection, _view);
+            axes_.submit(_queue);
         }
     }
 };
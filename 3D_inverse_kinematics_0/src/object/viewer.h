@@ -33,7 +33,7 @@ public:
 
     void gl_setup(GL_Context& ctx)
     {
-        shader_ = *(ctx.solid_color_shader);
+        shader_ = ctx.solid_color_shader;
         mesh_ = ctx.unit_sphere;
     }
 
@@ -42,20 +42,10 @@ public:
         base_orientation_ = mat4::rotate_y(y_angle_) * mat4::rotate_x(x_angle_) * mat4::identity();
     }
 
-    void draw(mat4& _projection, mat4& _view, Object& _light, bool _greyscale)
+    void submit(Render_queue& _queue)
     {
-        mat4 scaling = mat4::scale(scale_);
-        mat4 translation = mat4::translate(vec3(base_location_));
-        
-        mat4 m_matrix = translation * scaling;
-        mat4 mv_matrix = _view * m_matrix;
-        mat4 mvp_matrix = _projection * mv_matrix;
-
-        shader_.use();
-        shader_.set_uniform("color", color_);
-        shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-        
-        mesh_->draw();
+        mat4 m_matrix = mat4::translate(vec3(base_location_)) * mat4::scale(scale_);
+        _queue.add(shader_.get(), NULL, mesh_, m_matrix, color_);
     }
 
 };
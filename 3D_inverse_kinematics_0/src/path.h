@@ -3,6 +3,7 @@
 
 #include "gl.h"
 #include "glmath.h"
+#include "bezier.h"
 #include <vector>
 
 class Path {
@@ -20,55 +21,60 @@ public:
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
         glEnableVertexAttribArray(0);
 
-        // line strip indices
-        glGenBuffers(1, &m_ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-
         glBindVertexArray(0);
     }
 
-    void setPoints(const std::vector<vec3> &pts) {
-        m_num_pts = pts.size();
-        std::vector<GLfloat> positions(3 * m_num_pts);
-        for (size_t i = 0; i < m_num_pts; ++i) {
-            positions[3 * i    ] = pts[i][0];
-            positions[3 * i + 1] = pts[i][1];
-            positions[3 * i + 2] = pts[i][2];
-        }
+    // Upload n points, vec3 is three packed floats so they go to the buffer as they are.
+    // The buffer is only reallocated when it has to grow, e.g. for a path preview
+    // that is regenerated every frame.
+    void setPoints(const vec3 *pts, size_t n) {
+        m_num_pts = n;
         glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(GLfloat), positions.data(), GL_STATIC_DRAW);
+        if (n > m_capacity) {
+            glBufferData(GL_ARRAY_BUFFER, n * sizeof(vec3), pts, GL_DYNAMIC_DRAW);
+            m_capacity = n;
+        }
+        else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(vec3), pts);
+        }
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        std::vector<GLuint> indices(m_num_pts);
-        for (size_t i = 0; i < (size_t) m_num_pts; ++i) indices[i] = i;
-
-        glBindVertexArray(m_vao);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-        glBindVertexArray(0);
     }
 
+    void setPoints(const std::vector<vec3> &pts) { setPoints(pts.data(), pts.size()); }
+
     // Uniformly parametrized curve 'f' on the interval [0, 1]
     template<typename F>
     void sample(const F &f) {
-        std::vector<vec3> pts;
+        m_points.resize(m_resolution);
         for (size_t i = 0; i < (size_t) m_resolution; ++i)
-            pts.push_back(f(i / float(m_resolution - 1)));
-        setPoints(pts);
+            m_points[i] = f(i / float(m_resolution - 1));
+        setPoints(m_points);
+    }
+
+    // Spline on [0, 1], evaluated in one batch into the reused point and tangent
+    // buffers, see tangents() e.g. for Frame::alignAlong
+    void sample(const PiecewiseBezier &curve) {
+        m_points.resize(m_resolution);
+        m_tangents.resize(m_resolution);
+        curve.evaluate_range(0.0f, 1.0f, m_resolution, m_points.data(), m_tangents.data());
+        setPoints(m_points);
     }
 
+    /// tangents of the last sample() of a PiecewiseBezier
+    const std::vector<vec3> &tangents() const { return m_tangents; }
+
     /// render the path as line segments
     void draw() {
         glBindVertexArray(m_vao);
         glEnable(GL_LINE_SMOOTH);
         glLineWidth(1.0f); // Unfortunately, setting line widths > 1 is unsupported in modern OpenGL;
                            // we'll need to render polygons if we want thicker lines...
-        glDrawElements(GL_LINE_STRIP, m_num_pts, GL_UNSIGNED_INT, NULL);
+        glDrawArrays(GL_LINE_STRIP, 0, m_num_pts);
         glBindVertexArray(0);
     }
 
     ~Path() {
         if (m_vbo)  glDeleteBuffers(1, &m_vbo);
-        if (m_ibo)  glDeleteBuffers(1, &m_ibo);
         if (m_vao)  glDeleteVertexArrays(1, &m_vao);
     }
 
@@ -76,14 +82,17 @@ private:
     /// tessellation resolution
     unsigned int m_resolution, m_num_pts;
 
+    /// number of points the vertex buffer has room for
+    size_t m_capacity = 0;
+
+    /// reused sample buffers
+    std::vector<vec3> m_points, m_tangents;
+
     // vertex array object
     GLuint m_vao = 0;
 
     /// vertex buffer object
     GLuint m_vbo = 0;
-
-    /// index buffer object
-    GLuint m_ibo = 0;
 };
 
 #endif /* end of include guard: PATH_H */
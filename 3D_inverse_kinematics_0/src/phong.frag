@@ -16,8 +16,16 @@ in vec3 v2f_view;
 
 out vec4 f_color;
 
+// samplers default to texture unit 0
 uniform sampler2D tex;
-uniform bool greyscale;
+
+// the same for all objects of a frame, see scene_uniforms.h
+layout (std140) uniform Scene_uniforms {
+    mat4 projection_matrix;
+    mat4 view_matrix;
+    vec4 light_position; //in eye space coordinates already
+    int  greyscale;
+};
 
 const float shininess = 8.0;
 const vec3  sunlight = vec3(1.0, 0.941, 0.898);
@@ -52,7 +60,7 @@ void main()
     color = ambient + diffuse + specular;
 
     // convert RGB color to YUV color and use only the luminance
-    if (greyscale) color = vec3(0.299*color.r+0.587*color.g+0.114*color.b);
+    if (greyscale != 0) color = vec3(0.299*color.r+0.587*color.g+0.114*color.b);
 
     // add required alpha value
     f_color = vec4(color, 1.0);
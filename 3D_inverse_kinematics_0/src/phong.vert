@@ -19,10 +19,16 @@ out vec3 v2f_normal;
 out vec3 v2f_light;
 out vec3 v2f_view;
 
-uniform mat4 modelview_projection_matrix;
+// the same for all objects of a frame, see scene_uniforms.h
+layout (std140) uniform Scene_uniforms {
+    mat4 projection_matrix;
+    mat4 view_matrix;
+    vec4 light_position; //in eye space coordinates already
+    int  greyscale;
+};
+
 uniform mat4 modelview_matrix;
 uniform mat3 normal_matrix;
-uniform vec4 light_position; //in eye space coordinates already
 
 
 void main()
@@ -40,6 +46,6 @@ void main()
 	v2f_light = normalize(vec3(light_position) - vec3(modelview_matrix * v_position));
   v2f_view = -normalize(vec3(modelview_matrix * v_position));
 
-	gl_Position = modelview_projection_matrix * v_position;
+	gl_Position = projection_matrix * (modelview_matrix * v_position);
 
 }
@@ -0,0 +1,147 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef QUATERNION_H
+#define QUATERNION_H
+//=============================================================================
+
+#include <math.h>
+#include "glmath.h"
+
+//=============================================================================
+
+/// unit quaternion w + x i + y j + z k, the rotation state of a ball joint.
+/// Composing two rotations costs 16 multiplications and building the rotation
+/// matrix needs no trigonometry, unlike three Euler angles. Stored as the
+/// four floats (w, x, y, z), angles of rotation vectors are in radians.
+class Quaternion
+{
+public:
+    float w_, x_, y_, z_;
+
+public:
+    /// identity rotation
+    Quaternion() :
+        w_(1.0f), x_(0.0f), y_(0.0f), z_(0.0f)
+    {}
+
+    Quaternion(float _w, float _x, float _y, float _z) :
+        w_(_w), x_(_x), y_(_y), z_(_z)
+    {}
+
+    /// reads the four floats (w, x, y, z) at _q
+    static Quaternion load(const float* _q)
+    {
+        return Quaternion(_q[0], _q[1], _q[2], _q[3]);
+    }
+
+    /// writes the four floats (w, x, y, z) to _q
+    void store(float* _q) const
+    {
+        _q[0] = w_; _q[1] = x_; _q[2] = y_; _q[3] = z_;
+    }
+
+    /// rotation around the axis of _v by the angle norm(_v)
+    static Quaternion from_rotation_vector(const vec3& _v)
+    {
+        const float angle = norm(_v);
+        if (angle < 1e-6f) {
+            // sin(a/2)/a = 1/2 up to O(a^2)
+            return Quaternion(1.0f, 0.5f * _v[0], 0.5f * _v[1], 0.5f * _v[2]).normalized();
+        }
+        const float s = sinf(0.5f * angle) / angle;
+        return Quaternion(cosf(0.5f * angle), s * _v[0], s * _v[1], s * _v[2]);
+    }
+
+    /// quaternion of the orthonormal rotation _R. Goes through the largest of
+    /// w, x, y, z, which stays well conditioned for angles close to 180 degrees
+    static Quaternion from_rotation(const mat3& _R)
+    {
+        const float trace = _R(0,0) + _R(1,1) + _R(2,2);
+        if (trace > 0.0f) {
+            const float s = 2.0f * sqrtf(1.0f + trace);
+            return Quaternion(0.25f * s, (_R(2,1) - _R(1,2)) / s, (_R(0,2) - _R(2,0)) / s, (_R(1,0) - _R(0,1)) / s);
+        }
+        if (_R(0,0) > _R(1,1) && _R(0,0) > _R(2,2)) {
+            const float s = 2.0f * sqrtf(1.0f + _R(0,0) - _R(1,1) - _R(2,2));
+            return Quaternion((_R(2,1) - _R(1,2)) / s, 0.25f * s, (_R(0,1) + _R(1,0)) / s, (_R(0,2) + _R(2,0)) / s);
+        }
+        if (_R(1,1) > _R(2,2)) {
+            const float s = 2.0f * sqrtf(1.0f + _R(1,1) - _R(0,0) - _R(2,2));
+            return Quaternion((_R(0,2) - _R(2,0)) / s, (_R(0,1) + _R(1,0)) / s, 0.25f * s, (_R(1,2) + _R(2,1)) / s);
+        }
+        const float s = 2.0f * sqrtf(1.0f + _R(2,2) - _R(0,0) - _R(1,1));
+        return Quaternion((_R(1,0) - _R(0,1)) / s, (_R(0,2) + _R(2,0)) / s, (_R(1,2) + _R(2,1)) / s, 0.25f * s);
+    }
+
+    /// shortest rotation that takes the unit vector _from onto the unit vector _to
+    static Quaternion between(const vec3& _from, const vec3& _to)
+    {
+        const float d = dot(_from, _to);
+        if (d < -1.0f + 1e-6f) {
+            // opposite directions, half a turn around any axis normal to _from
+            vec3 axis = cross(vec3(1.0f, 0.0f, 0.0f), _from);
+            if (norm(axis) < 1e-3f) {
+                axis = cross(vec3(0.0f, 1.0f, 0.0f), _from);
+            }
+            axis = normalize(axis);
+            return Quaternion(0.0f, axis[0], axis[1], axis[2]);
+        }
+        // the half angle quaternion of (1 + d, _from x _to), without trigonometry
+        const vec3 c = cross(_from, _to);
+        return Quaternion(1.0f + d, c[0], c[1], c[2]).normalized();
+    }
+
+    /// axis times angle of the rotation, the angle in [0, pi]
+    vec3 log() const
+    {
+        // q and -q are the same rotation, take the short way around
+        const float sign = w_ < 0.0f ? -1.0f : 1.0f;
+        const vec3 v(sign * x_, sign * y_, sign * z_);
+        const float sin_half = norm(v);
+        if (sin_half < 1e-7f) {
+            return 2.0f * v;
+        }
+        return (2.0f * atan2f(sin_half, sign * w_) / sin_half) * v;
+    }
+
+    Quaternion normalized() const
+    {
+        const float s = 1.0f / sqrtf(w_ * w_ + x_ * x_ + y_ * y_ + z_ * z_);
+        return Quaternion(s * w_, s * x_, s * y_, s * z_);
+    }
+
+    /// rotation matrix of a unit quaternion
+    mat3 to_rotation() const
+    {
+        const float xx = x_ * x_, yy = y_ * y_, zz = z_ * z_;
+        const float xy = x_ * y_, xz = x_ * z_, yz = y_ * z_;
+        const float wx = w_ * x_, wy = w_ * y_, wz = w_ * z_;
+
+        mat3 r;
+        r(0,0) = 1.0f - 2.0f * (yy + zz);  r(0,1) = 2.0f * (xy - wz);         r(0,2) = 2.0f * (xz + wy);
+        r(1,0) = 2.0f * (xy + wz);         r(1,1) = 1.0f - 2.0f * (xx + zz);  r(1,2) = 2.0f * (yz - wx);
+        r(2,0) = 2.0f * (xz - wy);         r(2,1) = 2.0f * (yz + wx);         r(2,2) = 1.0f - 2.0f * (xx + yy);
+        return r;
+    }
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/// composition _q0 * _q1, first _q1 then _q0
+inline Quaternion operator*(const Quaternion& _q0, const Quaternion& _q1)
+{
+    return Quaternion(_q0.w_ * _q1.w_ - _q0.x_ * _q1.x_ - _q0.y_ * _q1.y_ - _q0.z_ * _q1.z_,
+                      _q0.w_ * _q1.x_ + _q0.x_ * _q1.w_ + _q0.y_ * _q1.z_ - _q0.z_ * _q1.y_,
+                      _q0.w_ * _q1.y_ - _q0.x_ * _q1.z_ + _q0.y_ * _q1.w_ + _q0.z_ * _q1.x_,
+                      _q0.w_ * _q1.z_ + _q0.x_ * _q1.y_ - _q0.y_ * _q1.x_ + _q0.z_ * _q1.w_);
+}
+
+
+//=============================================================================
+#endif // QUATERNION_H
+//=============================================================================
@@ -0,0 +1,100 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include "render_queue.h"
+#include <algorithm>
+
+
+//=============================================================================
+
+
+void Render_queue::begin(const mat4& _projection, const mat4& _view)
+{
+    projection_ = _projection;
+    view_ = _view;
+    items_.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Render_queue::add(Shader* _shader, Texture* _texture, Mesh* _mesh, const mat4& _model, const vec3& _color)
+{
+    Draw_item item;
+    item.shader_ = _shader;
+    item.texture_ = _texture;
+    item.mesh_ = _mesh;
+    item.model_ = _model;
+    item.color_ = _color;
+    items_.push_back(item);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Render_queue::flush()
+{
+    // program switches cost the most, then texture and vertex array binds
+    std::sort(items_.begin(), items_.end(), [](const Draw_item& _a, const Draw_item& _b) {
+        if (_a.shader_ != _b.shader_) return _a.shader_ < _b.shader_;
+        if (_a.texture_ != _b.texture_) return _a.texture_ < _b.texture_;
+        return _a.mesh_ < _b.mesh_;
+    });
+
+    stats_ = Render_stats();
+    stats_.items = (unsigned int)items_.size();
+
+    const Shader* shader = NULL;
+    const Texture* texture = NULL;
+    Mesh* mesh = NULL;
+    Locations locations = {-1, -1, -1, -1};
+
+    for (const Draw_item& item : items_)
+    {
+        if (item.shader_ != shader)
+        {
+            shader = item.shader_;
+            item.shader_->use();
+            locations.modelview_ = shader->uniform_location("modelview_matrix");
+            locations.normal_ = shader->uniform_location("normal_matrix");
+            locations.modelview_projection_ = shader->uniform_location("modelview_projection_matrix");
+            locations.color_ = shader->uniform_location("color");
+            stats_.program_binds++;
+        }
+        if (item.texture_ && item.texture_ != texture)
+        {
+            texture = item.texture_;
+            item.texture_->bind();
+            stats_.texture_binds++;
+        }
+        if (item.mesh_ != mesh)
+        {
+            mesh = item.mesh_;
+            mesh->bind();
+            stats_.mesh_binds++;
+        }
+
+        const mat4 mv_matrix = view_ * item.model_;
+        if (locations.modelview_ != -1)
+            set_uniform_by_location(locations.modelview_, mv_matrix);
+        if (locations.normal_ != -1)
+            set_uniform_by_location(locations.normal_, transpose(inverse(mat3(mv_matrix))));
+        if (locations.modelview_projection_ != -1)
+            set_uniform_by_location(locations.modelview_projection_, projection_ * mv_matrix);
+        if (locations.color_ != -1)
+            set_uniform_by_location(locations.color_, item.color_);
+
+        mesh->draw_bound();
+        stats_.draw_calls++;
+    }
+
+    glBindVertexArray(0);
+}
+
+
+//=============================================================================
@@ -0,0 +1,81 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+//=============================================================================
+
+#include <vector>
+#include "gl.h"
+#include "glmath.h"
+#include "shader.h"
+#include "texture.h"
+#include "mesh/mesh.h"
+
+//=============================================================================
+
+/// GL state changes and draw calls of one flush()
+struct Render_stats
+{
+    unsigned int items = 0;
+    unsigned int program_binds = 0;
+    unsigned int texture_binds = 0;
+    unsigned int mesh_binds = 0;
+    unsigned int draw_calls = 0;
+};
+
+/// collects the draw items of a frame and submits them sorted by program, texture
+/// and mesh, so every program, texture and vertex array is bound once per run of
+/// items that share it instead of once per item. Every item sets whichever of
+/// "modelview_matrix", "normal_matrix", "modelview_projection_matrix" and "color"
+/// its program has; uniforms shared by all items belong in Scene_uniforms.
+class Render_queue
+{
+public:
+    /// starts a frame, the items are transformed by _projection and _view
+    void begin(const mat4& _projection, const mat4& _view);
+
+    /// _mesh scaled and placed by the model matrix _model, drawn with _shader and
+    /// _texture, which is NULL for untextured programs
+    void add(Shader* _shader, Texture* _texture, Mesh* _mesh, const mat4& _model, const vec3& _color = vec3(1.0f));
+
+    /// sorts and draws the items added since begin()
+    void flush();
+
+    /// what the last flush() did
+    const Render_stats& stats() const { return stats_; }
+
+private:
+    struct Draw_item
+    {
+        Shader* shader_;
+        Texture* texture_;
+        Mesh* mesh_;
+        mat4 model_;
+        vec3 color_;
+    };
+
+    /// uniform locations of the bound program, looked up once per program switch
+    struct Locations
+    {
+        GLint modelview_;
+        GLint normal_;
+        GLint modelview_projection_;
+        GLint color_;
+    };
+
+    mat4 projection_;
+    mat4 view_;
+
+    /// the items of the frame, the memory is kept from frame to frame
+    std::vector<Draw_item> items_;
+
+    Render_stats stats_;
+};
+
+
+//=============================================================================
+#endif // RENDER_QUEUE_H
+//=============================================================================
@@ -0,0 +1,209 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef RIGID_TRANSFORM_H
+#define RIGID_TRANSFORM_H
+//=============================================================================
+
+#include <math.h>
+#include "glmath.h"
+
+//=============================================================================
+
+/// rotation followed by a translation, x -> rotation_ * x + translation_.
+/// Used for the frames along a kinematic chain instead of a general mat4:
+/// composing two transforms costs 36 multiplications instead of 64, and
+/// rotating a frame around one of its own axes only touches two columns.
+/// All angles are in degrees, like in mat4::rotate_x.
+class Rigid_transform
+{
+public:
+    /// orthonormal rotation
+    mat3 rotation_;
+
+    /// translation, the origin of the frame
+    vec3 translation_;
+
+public:
+    /// identity transform
+    Rigid_transform() :
+        translation_(0.0f)
+    {
+        set_identity_rotation();
+    }
+
+    Rigid_transform(const mat3& _rotation, const vec3& _translation) :
+        rotation_(_rotation),
+        translation_(_translation)
+    {}
+
+    /// rigid part of a homogeneous 4x4 matrix
+    explicit Rigid_transform(const mat4& _m) :
+        rotation_(_m),
+        translation_(_m(0,3), _m(1,3), _m(2,3))
+    {}
+
+    /// pure translation
+    static Rigid_transform translate(const vec3& _t)
+    {
+        Rigid_transform result;
+        result.translation_ = _t;
+        return result;
+    }
+
+    /// rotation around the x axis, the same as mat4::rotate_x
+    static Rigid_transform rotate_x(float _angle)
+    {
+        return Rigid_transform().rotated_x(_angle);
+    }
+
+    /// rotation around the y axis, the same as mat4::rotate_y
+    static Rigid_transform rotate_y(float _angle)
+    {
+        return Rigid_transform().rotated_y(_angle);
+    }
+
+    /// rotation around the z axis, the same as mat4::rotate_z
+    static Rigid_transform rotate_z(float _angle)
+    {
+        return Rigid_transform().rotated_z(_angle);
+    }
+
+    /// *this * rotate_x(_angle), the rotation around the frame's own x axis
+    Rigid_transform rotated_x(float _angle) const
+    {
+        Rigid_transform result(*this);
+        result.rotate_columns(1, 2, _angle);
+        return result;
+    }
+
+    /// *this * rotate_y(_angle), the rotation around the frame's own y axis
+    Rigid_transform rotated_y(float _angle) const
+    {
+        Rigid_transform result(*this);
+        result.rotate_columns(2, 0, _angle);
+        return result;
+    }
+
+    /// *this * rotate_z(_angle), the rotation around the frame's own z axis
+    Rigid_transform rotated_z(float _angle) const
+    {
+        Rigid_transform result(*this);
+        result.rotate_columns(0, 1, _angle);
+        return result;
+    }
+
+    /// *this * (_rotation, 0), turns the frame by a rotation given in its own coordinates
+    Rigid_transform rotated(const mat3& _rotation) const
+    {
+        Rigid_transform result(*this);
+        for (int j = 0; j < 3; j++) {
+            const vec3 column = apply_vector(vec3(_rotation(0,j), _rotation(1,j), _rotation(2,j)));
+            for (int i = 0; i < 3; i++) {
+                result.rotation_(i,j) = column[i];
+            }
+        }
+        return result;
+    }
+
+    /// the frame's x axis in world coordinates
+    vec3 base_x() const { return vec3(rotation_(0,0), rotation_(1,0), rotation_(2,0)); }
+    /// the frame's y axis in world coordinates
+    vec3 base_y() const { return vec3(rotation_(0,1), rotation_(1,1), rotation_(2,1)); }
+    /// the frame's z axis in world coordinates
+    vec3 base_z() const { return vec3(rotation_(0,2), rotation_(1,2), rotation_(2,2)); }
+
+    /// transforms the point _p
+    vec3 apply_point(const vec3& _p) const
+    {
+        return apply_vector(_p) + translation_;
+    }
+
+    /// rotates the direction _v, ignoring the translation
+    vec3 apply_vector(const vec3& _v) const
+    {
+        return vec3(rotation_(0,0) * _v[0] + rotation_(0,1) * _v[1] + rotation_(0,2) * _v[2],
+                    rotation_(1,0) * _v[0] + rotation_(1,1) * _v[1] + rotation_(1,2) * _v[2],
+                    rotation_(2,0) * _v[0] + rotation_(2,1) * _v[1] + rotation_(2,2) * _v[2]);
+    }
+
+    /// homogeneous 4x4 matrix of the transform
+    mat4 to_mat4() const
+    {
+        return to_mat4(vec3(1.0f));
+    }
+
+    /// homogeneous 4x4 matrix of *this * mat4::scale(_scale[0], _scale[1], _scale[2]),
+    /// e.g. the model matrix of a scaled unit mesh
+    mat4 to_mat4(const vec3& _scale) const
+    {
+        mat4 m;
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 3; i++) {
+                m(i,j) = rotation_(i,j) * _scale[j];
+            }
+            m(3,j) = 0.0f;
+            m(j,3) = translation_[j];
+        }
+        m(3,3) = 1.0f;
+        return m;
+    }
+
+private:
+    void set_identity_rotation()
+    {
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 3; i++) {
+                rotation_(i,j) = i == j ? 1.0f : 0.0f;
+            }
+        }
+    }
+
+    /// rotates columns _a and _b of the rotation by _angle, with _a x _b being the rotation axis
+    void rotate_columns(int _a, int _b, float _angle)
+    {
+        const float c = cosf(_angle * ((float)M_PI/180.0f));
+        const float s = sinf(_angle * ((float)M_PI/180.0f));
+        for (int i = 0; i < 3; i++) {
+            const float a = rotation_(i,_a);
+            const float b = rotation_(i,_b);
+            rotation_(i,_a) =  c * a + s * b;
+            rotation_(i,_b) = -s * a + c * b;
+        }
+    }
+};
+
+
+//-----------------------------------------------------------------------------
+
+
+/// composition _t0 * _t1, first _t1 then _t0
+inline Rigid_transform operator*(const Rigid_transform& _t0, const Rigid_transform& _t1)
+{
+    Rigid_transform result;
+    for (int j = 0; j < 3; j++) {
+        const vec3 column = _t0.apply_vector(vec3(_t1.rotation_(0,j), _t1.rotation_(1,j), _t1.rotation_(2,j)));
+        for (int i = 0; i < 3; i++) {
+            result.rotation_(i,j) = column[i];
+        }
+    }
+    result.translation_ = _t0.apply_point(_t1.translation_);
+    return result;
+}
+
+
+/// inverse transform, the rotation is transposed instead of inverted
+inline Rigid_transform inverse(const Rigid_transform& _t)
+{
+    mat3 rotation = transpose(_t.rotation_);
+    Rigid_transform result(rotation, vec3(0.0f));
+    result.translation_ = -result.apply_vector(_t.translation_);
+    return result;
+}
+
+
+//=============================================================================
+#endif // RIGID_TRANSFORM_H
+//=============================================================================
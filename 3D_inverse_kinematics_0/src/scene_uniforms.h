@@ -0,0 +1,78 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef SCENE_UNIFORMS_H
+#define SCENE_UNIFORMS_H
+//=============================================================================
+
+#include <cstring>
+#include "gl.h"
+#include "glmath.h"
+
+//=============================================================================
+
+/// uniforms shared by all shaders of a frame, in one uniform buffer object that
+/// is updated once per frame. Shaders declare the block
+///
+///     layout (std140) uniform Scene_uniforms {
+///         mat4 projection_matrix;
+///         mat4 view_matrix;
+///         vec4 light_position;    // in eye space
+///         int  greyscale;
+///     };
+///
+/// and connect it with Shader::bind_uniform_block("Scene_uniforms", Scene_uniforms::binding).
+class Scene_uniforms
+{
+public:
+    /// uniform buffer binding point of the block
+    static const GLuint binding = 0;
+
+    ~Scene_uniforms()
+    {
+        if (ubo_) glDeleteBuffers(1, &ubo_);
+    }
+
+    void gl_setup()
+    {
+        if (!ubo_) glGenBuffers(1, &ubo_);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo_);
+    }
+
+    /// uploads the uniforms of the frame, \p _light_position in eye space
+    void update(const mat4& _projection, const mat4& _view, const vec4& _light_position, bool _greyscale)
+    {
+        // std140: the matrices are four vec4 columns, the int is padded to a vec4
+        Block block;
+        memcpy(block.projection_matrix, _projection.data(), sizeof(block.projection_matrix));
+        memcpy(block.view_matrix, _view.data(), sizeof(block.view_matrix));
+        memcpy(block.light_position, _light_position.data(), sizeof(block.light_position));
+        block.greyscale[0] = _greyscale ? 1 : 0;
+        block.greyscale[1] = block.greyscale[2] = block.greyscale[3] = 0;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    struct Block
+    {
+        float projection_matrix[16];
+        float view_matrix[16];
+        float light_position[4];
+        GLint greyscale[4];
+    };
+
+    GLuint ubo_ = 0;
+};
+
+
+//=============================================================================
+#endif // SCENE_UNIFORMS_H
+//=============================================================================
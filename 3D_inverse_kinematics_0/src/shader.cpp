@@ -17,6 +17,12 @@
 //=============================================================================
 
 
+GLint Shader::bound_program_ = 0;
+
+
+//-----------------------------------------------------------------------------
+
+
 Shader::Shader() :
     pid_(0), vid_(0), fid_(0), gid_(0)
 {
@@ -37,12 +43,14 @@ Shader::~Shader()
 
 void Shader::cleanup()
 {
+    if (pid_ && pid_ == bound_program_) bound_program_ = 0;
     if (pid_) glDeleteProgram(pid_);
     if (vid_) glDeleteShader(vid_);
     if (fid_) glDeleteShader(fid_);
     if (fid_) glDeleteShader(fid_);
 
     pid_ = vid_ = fid_ = gid_ = 0;
+    uniform_locations_.clear();
 }
 
 
@@ -98,6 +106,8 @@ bool Shader::load(const char* vfile, const char* ffile, const char* gfile)
     }
     glCheckError();
 
+    cache_uniform_locations();
+
     return true;
 }
 
@@ -105,6 +115,65 @@ bool Shader::load(const char* vfile, const char* ffile, const char* gfile)
 //-----------------------------------------------------------------------------
 
 
+void Shader::cache_uniform_locations()
+{
+    uniform_locations_.clear();
+
+    GLint n_uniforms = 0, max_length = 0;
+    glGetProgramiv(pid_, GL_ACTIVE_UNIFORMS, &n_uniforms);
+    glGetProgramiv(pid_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<char> name(max_length + 1);
+    for (GLint i = 0; i < n_uniforms; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(pid_, i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(pid_, &name[0]);
+        if (location == -1) continue;
+
+        // arrays are reported as "name[0]", they are set by their plain name
+        std::string uniform(&name[0], length);
+        if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+            uniform.resize(uniform.size() - 3);
+
+        uniform_locations_.push_back(std::make_pair(uniform, location));
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+GLint Shader::uniform_location(const char* name) const
+{
+    for (size_t i = 0; i < uniform_locations_.size(); ++i)
+    {
+        if (strcmp(uniform_locations_[i].first.c_str(), name) == 0)
+            return uniform_locations_[i].second;
+    }
+    return -1;
+}
+
+
+//-----------------------------------------------------------------------------
+
+
+void Shader::bind_uniform_block(const char* name, GLuint binding)
+{
+    if (!pid_) return;
+    GLuint index = glGetUniformBlockIndex(pid_, name);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(pid_, index, binding);
+}
+
+
+//-----------------------------------------------------------------------------
+
+
 GLint Shader::load_and_compile(const char* filename, GLenum type)
 {
     // read file to string
@@ -163,7 +232,11 @@ GLint Shader::load_and_compile(const char* filename, GLenum type)
 
 void Shader::use()
 {
-    if (pid_) glUseProgram(pid_);
+    if (pid_ && pid_ != bound_program_)
+    {
+        glUseProgram(pid_);
+        bound_program_ = pid_;
+    }
 }
 
 
@@ -173,6 +246,25 @@ void Shader::use()
 void Shader::disable()
 {
     glUseProgram(0);
+    bound_program_ = 0;
+}
+
+
+//=============================================================================
+
+
+std::shared_ptr<Shader> Shader_registry::load(const char* vfile, const char* ffile, const char* gfile)
+{
+    std::string key = std::string(vfile) + '\n' + ffile + '\n' + (gfile ? gfile : "");
+
+    std::shared_ptr<Shader>& shader = shaders_[key];
+    if (!shader)
+    {
+        // a program that fails to compile is kept as well, its use() does nothing
+        shader = std::make_shared<Shader>();
+        shader->load(vfile, ffile, gfile);
+    }
+    return shader;
 }
 
 //-----------------------------------------------------------------------------
@@ -12,11 +12,17 @@
 
 #include "gl.h"
 #include "glmath.h"
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 //=============================================================================
 
-/// shader class for easy handling of the shader
+/// shader class for easy handling of the shader. Owns its GL program and cannot be
+/// copied, objects share one program through a std::shared_ptr<Shader>, see Shader_registry
 class Shader
 {
 public:
@@ -26,6 +32,9 @@ public:
     /// default destructor
     ~Shader();
 
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     /// load (from file), compile, and link vertex and fragment shader,
     /// optionially also a geometry shader
     /// \param vfile string with the adress to the vertex shader
@@ -36,7 +45,7 @@ public:
     /// deletes all shader and frees GPU shader capacities
     void  cleanup();
 
-    /// enable/bind this shader program
+    /// enable/bind this shader program, does nothing if it is bound already
     void use();
     /// disable/unbind this shader program
     void disable();
@@ -51,12 +60,23 @@ public:
     template<typename T>
     void set_uniform(const char* name, const T &value, bool optional = false);
 
+    /// location of a uniform of the linked program, -1 if it is not active.
+    /// Looked up in the locations cached at load(), not by the driver
+    GLint uniform_location(const char* name) const;
+
+    /// connects the uniform block \p name to the uniform buffer binding point \p binding,
+    /// e.g. Scene_uniforms::binding. Does nothing if the program has no such block
+    void bind_uniform_block(const char* name, GLuint binding);
+
 private:
     /// loads a vertex/fragmend/geometry shader from a file and compiles it
     /// \param filename the location and name of the shader
     /// \param type the type of the shader (vertex, geometry, fragment)
     GLint load_and_compile(const char* filename, GLenum type);
 
+    /// asks the linked program for its active uniforms and caches their locations
+    void cache_uniform_locations();
+
 private:
     /// id of the linked shader program
     GLint pid_;
@@ -66,6 +86,33 @@ private:
     GLint fid_;
     /// id of the geometry shader
     GLint gid_;
+
+    /// name and location of every active uniform outside of uniform blocks, a
+    /// program has only a handful so a linear search is the fastest lookup
+    std::vector<std::pair<std::string, GLint> > uniform_locations_;
+
+    /// the program of the last use(), glUseProgram is only called when it changes
+    static GLint bound_program_;
+};
+
+
+//=============================================================================
+
+
+/// compiles every combination of shader files once and hands out shared handles to it
+class Shader_registry
+{
+public:
+    /// the program of these files, loaded on the first request. The program is
+    /// deleted when the registry and all holders of the handle are gone
+    std::shared_ptr<Shader> load(const char* vfile, const char* ffile, const char* gfile=NULL);
+
+    /// forgets all programs, holders of a handle keep theirs
+    void clear() { shaders_.clear(); }
+
+private:
+    /// programs by their file names
+    std::map<std::string, std::shared_ptr<Shader> > shaders_;
 };
 
 inline void set_uniform_by_location(int loc, bool         val) { glUniform1i       (loc, static_cast<int>(val));          }
@@ -79,7 +126,7 @@ inline void set_uniform_by_location(int loc, const mat4  &val) { glUniformMatrix
 template<typename T>
 void Shader::set_uniform(const char* name, const T &value, bool optional) {
     if (!pid_) return;
-    int location = glGetUniformLocation(pid_, name);
+    int location = uniform_location(name);
     if (location == -1) {
         if (!optional)
             std::cerr << "Invalid uniform location for: " << name << std::endl;
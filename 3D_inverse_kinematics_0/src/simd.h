@@ -0,0 +1,109 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef SIMD_H
+#define SIMD_H
+//=============================================================================
+
+/// \file simd.h Minimal 4-wide float vector for the glmath kernels.
+/// The kernels in glmath.cpp are written once against the simd4f_* functions
+/// below, which map to SSE on x86, to NEON on ARM and to plain loops
+/// otherwise. Define GLMATH_NO_SIMD to force the scalar version.
+/// GLMATH_SIMD names the backend in use. Only the mat4 products and the mat4
+/// transpose use it, the mat3 functions (inverse included) are still scalar.
+/// At -O3 GCC vectorizes the plain loops about as well, the kernels pay off
+/// at -O2 (RelWithDebInfo), see ik_bench --scenario glmath.
+
+#if !defined(GLMATH_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define GLMATH_SIMD_SSE
+#define GLMATH_SIMD "sse"
+#include <xmmintrin.h>
+#elif !defined(GLMATH_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define GLMATH_SIMD_NEON
+#define GLMATH_SIMD "neon"
+#include <arm_neon.h>
+#else
+#define GLMATH_SIMD "scalar"
+#endif
+
+//=============================================================================
+
+
+#if defined(GLMATH_SIMD_SSE)
+
+typedef __m128 simd4f;
+
+/// loads 4 floats, _p does not have to be aligned
+inline simd4f simd4f_load(const float* _p) { return _mm_loadu_ps(_p); }
+/// stores 4 floats, _p does not have to be aligned
+inline void simd4f_store(float* _p, simd4f _a) { _mm_storeu_ps(_p, _a); }
+/// all 4 lanes set to _s
+inline simd4f simd4f_splat(float _s) { return _mm_set1_ps(_s); }
+inline simd4f simd4f_add(simd4f _a, simd4f _b) { return _mm_add_ps(_a, _b); }
+inline simd4f simd4f_mul(simd4f _a, simd4f _b) { return _mm_mul_ps(_a, _b); }
+
+/// transposes the 4x4 matrix whose columns are _c0.._c3
+inline void simd4f_transpose(simd4f& _c0, simd4f& _c1, simd4f& _c2, simd4f& _c3) { _MM_TRANSPOSE4_PS(_c0, _c1, _c2, _c3); }
+
+
+#elif defined(GLMATH_SIMD_NEON)
+
+typedef float32x4_t simd4f;
+
+inline simd4f simd4f_load(const float* _p) { return vld1q_f32(_p); }
+inline void simd4f_store(float* _p, simd4f _a) { vst1q_f32(_p, _a); }
+inline simd4f simd4f_splat(float _s) { return vdupq_n_f32(_s); }
+inline simd4f simd4f_add(simd4f _a, simd4f _b) { return vaddq_f32(_a, _b); }
+inline simd4f simd4f_mul(simd4f _a, simd4f _b) { return vmulq_f32(_a, _b); }
+
+inline void simd4f_transpose(simd4f& _c0, simd4f& _c1, simd4f& _c2, simd4f& _c3)
+{
+    float32x4x2_t t01 = vtrnq_f32(_c0, _c1);
+    float32x4x2_t t23 = vtrnq_f32(_c2, _c3);
+    _c0 = vcombine_f32(vget_low_f32(t01.val[0]),  vget_low_f32(t23.val[0]));
+    _c1 = vcombine_f32(vget_low_f32(t01.val[1]),  vget_low_f32(t23.val[1]));
+    _c2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    _c3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+
+#else
+
+struct simd4f
+{
+    float v[4];
+};
+
+inline simd4f simd4f_load(const float* _p) { simd4f r = {{_p[0], _p[1], _p[2], _p[3]}}; return r; }
+inline void simd4f_store(float* _p, simd4f _a) { for (int i = 0; i < 4; i++) _p[i] = _a.v[i]; }
+inline simd4f simd4f_splat(float _s) { simd4f r = {{_s, _s, _s, _s}}; return r; }
+inline simd4f simd4f_add(simd4f _a, simd4f _b) { for (int i = 0; i < 4; i++) _a.v[i] += _b.v[i]; return _a; }
+inline simd4f simd4f_mul(simd4f _a, simd4f _b) { for (int i = 0; i < 4; i++) _a.v[i] *= _b.v[i]; return _a; }
+
+inline void simd4f_transpose(simd4f& _c0, simd4f& _c1, simd4f& _c2, simd4f& _c3)
+{
+    simd4f* c[4] = {&_c0, &_c1, &_c2, &_c3};
+    for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4; j++) {
+            float t = c[i]->v[j];
+            c[i]->v[j] = c[j]->v[i];
+            c[j]->v[i] = t;
+        }
+    }
+}
+
+#endif
+
+
+//-----------------------------------------------------------------------------
+
+
+/// _a * _b + _c, kept as two operations so all backends round the same way
+inline simd4f simd4f_madd(simd4f _a, simd4f _b, simd4f _c) { return simd4f_add(simd4f_mul(_a, _b), _c); }
+
+
+//=============================================================================
+#endif // SIMD_H
+//=============================================================================
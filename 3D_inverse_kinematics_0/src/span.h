@@ -0,0 +1,53 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef SPAN_H
+#define SPAN_H
+//=============================================================================
+
+#include <cassert>
+#include <cstddef>
+
+//=============================================================================
+
+/// non-owning view of a contiguous range of values, e.g. the DOFs of one
+/// object inside the flat state vector of the kinematic chain
+template<typename T>
+class Span
+{
+public:
+    /// empty span
+    Span() : data_(nullptr), size_(0) {}
+
+    /// view _size values starting at _data
+    Span(T* _data, size_t _size) : data_(_data), size_(_size) {}
+
+    /// number of values in the span
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    T* data() const { return data_; }
+
+    T* begin() const { return data_; }
+
+    T* end() const { return data_ + size_; }
+
+    /// access the _i'th value (_i from 0 to size()-1)
+    T& operator[](size_t _i) const
+    {
+        assert(_i < size_);
+        return data_[_i];
+    }
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+
+//=============================================================================
+#endif // SPAN_H
+//=============================================================================
@@ -0,0 +1,171 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <math.h>
+
+#include "time_parameterization.h"
+
+
+void Time_parameterization::set_limits(Span<const float> _max_velocity, Span<const float> _max_acceleration) {
+    assert(_max_velocity.size() == _max_acceleration.size());
+    max_velocity_.assign(_max_velocity.begin(), _max_velocity.end());
+    max_acceleration_.assign(_max_acceleration.begin(), _max_acceleration.end());
+}
+
+
+bool Time_parameterization::compute(const std::vector<float>& _s, const std::vector<float>& _dof_path) {
+    const size_t n = _s.size();
+    const size_t d = n_dofs();
+    assert(n >= 2 && d > 0 && _dof_path.size() == n * d);
+
+    if (n == 2) {
+        // a straight segment has no samples to accelerate and brake between, it is
+        // split at its middle: full acceleration up to there, full braking after it
+        const std::vector<float> s = {_s[0], 0.5f * (_s[0] + _s[1]), _s[1]};
+        std::vector<float> dof_path(3 * d);
+        for (size_t j = 0; j < d; j++) {
+            dof_path[j] = _dof_path[j];
+            dof_path[d + j] = 0.5f * (_dof_path[j] + _dof_path[d + j]);
+            dof_path[2 * d + j] = _dof_path[d + j];
+        }
+        return compute(s, dof_path);
+    }
+
+    const float unbounded = std::numeric_limits<float>::max();
+    s_ = _s;
+    x_.resize(n);
+    times_.resize(n);
+    c_.resize(n * d);
+    e_.resize(n * d);
+    x_limit_.assign(n, unbounded);
+    x_reachable_.resize(n);
+
+    // q'(s) and q''(s) by finite differences on the non-uniform samples, the
+    // velocity limit and the limits of the pairs of acceleration bounds give the
+    // largest x at every sample
+    for (size_t i = 0; i < n; i++) {
+        const size_t m = std::min(std::max(i, (size_t)1), n - 2);
+        const float h0 = _s[m] - _s[m - 1];
+        const float h1 = _s[m + 1] - _s[m];
+        assert(h0 > 0.0f && h1 > 0.0f);
+        const float* q0 = &_dof_path[(m - 1) * d];
+        const float* q1 = &_dof_path[m * d];
+        const float* q2 = &_dof_path[(m + 1) * d];
+        float* c = &c_[i * d];
+        float* e = &e_[i * d];
+
+        for (size_t j = 0; j < d; j++) {
+            float a;
+            if (i == 0) {
+                a = (q1[j] - q0[j]) / h0;
+            }
+            else if (i == n - 1) {
+                a = (q2[j] - q1[j]) / h1;
+            }
+            else {
+                a = (q2[j] - q0[j]) / (h0 + h1);
+            }
+            // the second derivative of the neighbouring sample at the ends
+            const float b = 2.0f * (h0 * q2[j] - (h0 + h1) * q1[j] + h1 * q0[j]) / (h0 * h1 * (h0 + h1));
+
+            if (fabsf(a) > 1e-6f) {
+                c[j] = max_acceleration_[j] / fabsf(a);
+                e[j] = b / a;
+                x_limit_[i] = std::min(x_limit_[i], max_velocity_[j] * max_velocity_[j] / (a * a));
+            }
+            else {
+                // the DOF stands still, only the curvature term b x is left
+                c[j] = std::numeric_limits<float>::infinity();
+                e[j] = 0.0f;
+                if (fabsf(b) > 1e-6f) {
+                    x_limit_[i] = std::min(x_limit_[i], max_acceleration_[j] / fabsf(b));
+                }
+            }
+        }
+
+        // the bounds of DOF j and DOF k cross at x = (c_j + c_k) / (e_k - e_j)
+        for (size_t j = 0; j < d; j++) {
+            for (size_t k = 0; k < d; k++) {
+                if (e[k] > e[j]) {
+                    x_limit_[i] = std::min(x_limit_[i], (c[j] + c[k]) / (e[k] - e[j]));
+                }
+            }
+        }
+    }
+
+    // backward pass: with u constant between two samples, x_i+1 = x_i + 2 ds u_i. The
+    // largest x_i from which the smallest u_i still reaches x_i+1 <= x_reachable_[i+1]
+    // satisfies x_i (1 - 2 ds e_j) <= x_reachable_[i+1] + 2 ds c_j for every DOF j
+    x_reachable_[n - 1] = 0.0f;
+    for (size_t i = n - 1; i-- > 0;) {
+        const float ds2 = 2.0f * (_s[i + 1] - _s[i]);
+        float x = x_limit_[i];
+        for (size_t j = 0; j < d; j++) {
+            const float f = 1.0f - ds2 * e_[i * d + j];
+            if (f > 0.0f) {
+                x = std::min(x, (x_reachable_[i + 1] + ds2 * c_[i * d + j]) / f);
+            }
+        }
+        x_reachable_[i] = std::max(0.0f, x);
+    }
+
+    // forward pass: accelerate as hard as the limits allow without leaving the reachable set
+    x_[0] = 0.0f;
+    times_[0] = 0.0f;
+    for (size_t i = 0; i + 1 < n; i++) {
+        const float ds2 = 2.0f * (_s[i + 1] - _s[i]);
+        float lower, upper;
+        acceleration_bounds(i, x_[i], lower, upper);
+        const float u = std::min(upper, (x_reachable_[i + 1] - x_[i]) / ds2);
+        x_[i + 1] = std::max(0.0f, x_[i] + ds2 * u);
+
+        const float v = sqrtf(x_[i]) + sqrtf(x_[i + 1]);
+        if (v <= 0.0f) {
+            return false;
+        }
+        times_[i + 1] = times_[i] + ds2 / v;
+    }
+    return true;
+}
+
+
+void Time_parameterization::acceleration_bounds(size_t _i, float _x, float& _lower, float& _upper) const {
+    _lower = -std::numeric_limits<float>::infinity();
+    _upper = std::numeric_limits<float>::infinity();
+    const size_t d = n_dofs();
+    for (size_t j = 0; j < d; j++) {
+        const float c = c_[_i * d + j];
+        const float e = e_[_i * d + j];
+        _lower = std::max(_lower, -c - e * _x);
+        _upper = std::min(_upper, c - e * _x);
+    }
+}
+
+
+float Time_parameterization::position(float _t) const {
+    assert(times_.size() >= 2);
+    if (_t <= 0.0f) {
+        return s_.front();
+    }
+    if (_t >= times_.back()) {
+        return s_.back();
+    }
+
+    // constant acceleration u between the samples i and i+1
+    const size_t i = std::upper_bound(times_.begin(), times_.end(), _t) - times_.begin() - 1;
+    const float ds = s_[i + 1] - s_[i];
+    const float u = (x_[i + 1] - x_[i]) / (2.0f * ds);
+    const float tau = _t - times_[i];
+    return std::min(s_[i + 1], s_[i] + sqrtf(x_[i]) * tau + 0.5f * u * tau * tau);
+}
+
+
+float Time_parameterization::velocity(size_t _i) const {
+    return sqrtf(x_[_i]);
+}
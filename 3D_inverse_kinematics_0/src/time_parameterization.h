@@ -0,0 +1,77 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef TIME_PARAMETERIZATION_H
+#define TIME_PARAMETERIZATION_H
+//=============================================================================
+
+#include <vector>
+#include "span.h"
+
+//=============================================================================
+
+/// time optimal schedule along a path under per DOF velocity and acceleration
+/// limits, in the style of TOPP-RA. The path is given at samples s_0 < ... < s_n-1
+/// of its parameter, e.g. the arc length along a Trajectory, with the joint
+/// path q(s) solved by IK at every sample. With x = (ds/dt)^2 and u = d^2s/dt^2,
+/// every limit is linear in (x, u) at a sample:
+///   |q'(s)| sqrt(x) <= max velocity,   |q'(s) u + q''(s) x| <= max acceleration,
+/// so one backward pass finds the largest x from which the end can still be
+/// reached at rest, and one forward pass accelerates as hard as that allows.
+/// Both passes are linear in the number of samples.
+class Time_parameterization
+{
+public:
+    /// per DOF limits in degrees per second and degrees per second^2, both spans hold n_dofs values
+    void set_limits(Span<const float> _max_velocity, Span<const float> _max_acceleration);
+
+    size_t n_dofs() const { return max_velocity_.size(); }
+
+    /// schedule of the joint path _dof_path, n_dofs() values per sample, continuous in the
+    /// path such as Kinematics::dof_values() of consecutive IK solutions, at the increasing
+    /// path parameters _s. Starts and ends at rest. Returns false if the path cannot be
+    /// traversed, e.g. with a DOF that has to turn but has no velocity to do so. Two samples
+    /// are a straight segment, it gets a third sample in its middle, also in times()
+    bool compute(const std::vector<float>& _s, const std::vector<float>& _dof_path);
+
+    /// time at which the schedule passes every sample
+    const std::vector<float>& times() const { return times_; }
+
+    /// time from the start to the end of the path
+    float duration() const { return times_.empty() ? 0.0f : times_.back(); }
+
+    /// path parameter at time _t, clamped to the path, O(log n)
+    float position(float _t) const;
+
+    /// path velocity ds/dt at every sample
+    float velocity(size_t _i) const;
+
+private:
+    /// the bounds [-c - e x, c - e x] of u one DOF allows at a sample,
+    /// with c = max acceleration / |q'| and e = q'' / q'
+    void acceleration_bounds(size_t _i, float _x, float& _lower, float& _upper) const;
+
+    std::vector<float> max_velocity_;
+    std::vector<float> max_acceleration_;
+
+    /// path parameter, x = (ds/dt)^2 and time of every sample
+    std::vector<float> s_;
+    std::vector<float> x_;
+    std::vector<float> times_;
+
+    /// per sample and DOF: c and e of the acceleration bounds, infinity and 0 for a DOF with q' = 0
+    std::vector<float> c_;
+    std::vector<float> e_;
+
+    /// per sample: the largest x the limits allow, and the largest x from which the
+    /// end can still be reached
+    std::vector<float> x_limit_;
+    std::vector<float> x_reachable_;
+};
+
+
+//=============================================================================
+#endif // TIME_PARAMETERIZATION_H
+//=============================================================================
@@ -0,0 +1,127 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+
+#include <algorithm>
+#include <cassert>
+
+#include "trajectory.h"
+
+
+Trajectory::Trajectory(unsigned int _samples_per_segment, unsigned int _table_size) :
+    samples_per_segment_(_samples_per_segment),
+    table_size_(_table_size)
+{
+    assert(_samples_per_segment >= 1 && _table_size >= 2);
+}
+
+
+void Trajectory::set_bezier(const std::vector<vec3>& _points) {
+    assert(_points.size() >= 4 && (_points.size() - 1) % 3 == 0);
+    build(_points);
+}
+
+
+void Trajectory::set_cubic(const vec3& _p0, const vec3& _p1, const vec3& _p2, const vec3& _p3) {
+    build({_p0, _p1, _p2, _p3});
+}
+
+
+void Trajectory::set_quadratic(const vec3& _p0, const vec3& _p1, const vec3& _p2) {
+    // degree elevation, the cubic with these control points is the same curve
+    build({_p0, _p0 + (2.0f / 3.0f) * (_p1 - _p0), _p2 + (2.0f / 3.0f) * (_p1 - _p2), _p2});
+}
+
+
+void Trajectory::set_line(const vec3& _p0, const vec3& _p1) {
+    build({_p0, _p0 + (1.0f / 3.0f) * (_p1 - _p0), _p0 + (2.0f / 3.0f) * (_p1 - _p0), _p1});
+}
+
+
+void Trajectory::build(const std::vector<vec3>& _points) {
+    const size_t n_segments = (_points.size() - 1) / 3;
+    const unsigned int n = samples_per_segment_;
+    samples_.resize(n_segments * n + 1);
+    distances_.resize(samples_.size());
+
+    // forward differences of P(t) = a t^3 + b t^2 + c t + d with step h, three additions
+    // per sample instead of the Bernstein polynomials. The running sums are kept in
+    // double since their rounding errors grow with the number of steps
+    const double h = 1.0 / n;
+    for (size_t s = 0; s < n_segments; s++) {
+        const vec3* p = &_points[3 * s];
+        double point[3], d1[3], d2[3], d3[3];
+        for (int k = 0; k < 3; k++) {
+            const double a = -p[0][k] + 3.0 * p[1][k] - 3.0 * p[2][k] + p[3][k];
+            const double b = 3.0 * (p[0][k] - 2.0 * p[1][k] + p[2][k]);
+            const double c = 3.0 * (p[1][k] - p[0][k]);
+            point[k] = p[0][k];
+            d1[k] = a * h * h * h + b * h * h + c * h;
+            d2[k] = 6.0 * a * h * h * h + 2.0 * b * h * h;
+            d3[k] = 6.0 * a * h * h * h;
+        }
+
+        vec3* out = &samples_[s * n];
+        for (unsigned int i = 0; i < n; i++) {
+            out[i] = vec3((float)point[0], (float)point[1], (float)point[2]);
+            for (int k = 0; k < 3; k++) {
+                point[k] += d1[k];
+                d1[k] += d2[k];
+                d2[k] += d3[k];
+            }
+        }
+    }
+    samples_.back() = _points.back();
+
+    distances_[0] = 0.0f;
+    for (size_t i = 1; i < samples_.size(); i++) {
+        distances_[i] = distances_[i - 1] + norm(samples_[i] - samples_[i - 1]);
+    }
+    length_ = distances_.back();
+
+    // one merge pass over the samples resamples the polyline at equal distances
+    table_.resize(table_size_);
+    size_t i = 0;
+    for (unsigned int j = 0; j < table_size_; j++) {
+        const float s = length_ * j / (table_size_ - 1);
+        while (i + 2 < samples_.size() && distances_[i + 1] < s) {
+            i++;
+        }
+        const float span = distances_[i + 1] - distances_[i];
+        const float f = span > 0.0f ? std::min(1.0f, std::max(0.0f, (s - distances_[i]) / span)) : 0.0f;
+        table_[j] = samples_[i] + f * (samples_[i + 1] - samples_[i]);
+    }
+    table_.back() = samples_.back();
+}
+
+
+vec3 Trajectory::at(float _u) const {
+    assert(!table_.empty());
+    const float x = std::min(1.0f, std::max(0.0f, _u)) * (table_size_ - 1);
+    const unsigned int i = std::min((unsigned int)x, table_size_ - 2);
+    const float f = x - i;
+    return table_[i] + f * (table_[i + 1] - table_[i]);
+}
+
+
+vec3 Trajectory::at_distance(float _s) const {
+    return at(length_ > 0.0f ? _s / length_ : 0.0f);
+}
+
+
+void Trajectory::sample(unsigned int _n, std::vector<vec4>& _targets) const {
+    _targets.resize(_n);
+    for (unsigned int i = 0; i < _n; i++) {
+        const float u = _n > 1 ? (float)i / (_n - 1) : 0.0f;
+        _targets[i] = vec4(at(u), 1.0f);
+    }
+}
+
+
+std::vector<vec4> Trajectory::sample(unsigned int _n) const {
+    std::vector<vec4> targets;
+    sample(_n, targets);
+    return targets;
+}
@@ -0,0 +1,71 @@
+//=============================================================================
+//
+// Documentation here
+//
+//=============================================================================
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+//=============================================================================
+
+#include <vector>
+#include "glmath.h"
+
+//=============================================================================
+
+/// target path of the end effector, parameterized by arc length.
+/// The curve is a chain of cubic Bezier segments, lines and quadratic curves are
+/// raised to cubics. It is sampled once by forward differencing and resampled into
+/// a table of points equally spaced along the curve, so consecutive targets are the
+/// same distance apart and every query is O(1), a lookup and one interpolation.
+class Trajectory
+{
+public:
+    /// _samples_per_segment points are evaluated per Bezier segment, the arc length
+    /// table has _table_size entries
+    Trajectory(unsigned int _samples_per_segment = 256, unsigned int _table_size = 1024);
+
+    /// piecewise cubic Bezier curve, _points holds the 3n+1 control points of n segments
+    /// that share their end points, e.g. PiecewiseBezier::bezier_control_points()
+    void set_bezier(const std::vector<vec3>& _points);
+
+    void set_cubic(const vec3& _p0, const vec3& _p1, const vec3& _p2, const vec3& _p3);
+
+    void set_quadratic(const vec3& _p0, const vec3& _p1, const vec3& _p2);
+
+    void set_line(const vec3& _p0, const vec3& _p1);
+
+    /// length of the curve
+    float length() const { return length_; }
+
+    /// point at the fraction _u in [0, 1] of the arc length
+    vec3 at(float _u) const;
+
+    /// point at the distance _s along the curve, clamped to [0, length()]
+    vec3 at_distance(float _s) const;
+
+    /// writes _n targets equally spaced along the curve into _targets, the first
+    /// at the start and the last at the end of the curve. Reuses the memory of _targets
+    void sample(unsigned int _n, std::vector<vec4>& _targets) const;
+
+    std::vector<vec4> sample(unsigned int _n) const;
+
+private:
+    /// evaluates the Bezier segments into samples_ and builds the arc length table
+    void build(const std::vector<vec3>& _points);
+
+    unsigned int samples_per_segment_;
+    unsigned int table_size_;
+
+    /// the curve at uniform parameter steps and the arc length up to every sample
+    std::vector<vec3> samples_;
+    std::vector<float> distances_;
+
+    /// points equally spaced in arc length, table_[i] at i / (table_size_ - 1) of the length
+    std::vector<vec3> table_;
+    float length_ = 0.0f;
+};
+
+
+//=============================================================================
+#endif // TRAJECTORY_H
+//=============================================================================